@@ -215,14 +215,9 @@ static ID3D12RootSignature *create_default_root_signature(ID3D12Device *device)
     return root_signature;
 }
 
-#define create_pipeline_state(a, b, c, d) create_pipeline_state_(__LINE__, a, b, c, d)
-static ID3D12PipelineState *create_pipeline_state_(unsigned int line, ID3D12Device *device,
+static void init_pipeline_state_desc(D3D12_GRAPHICS_PIPELINE_STATE_DESC *desc,
         ID3D12RootSignature *root_signature, DXGI_FORMAT rt_format, const D3D12_SHADER_BYTECODE *ps)
 {
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC pipeline_state_desc;
-    ID3D12PipelineState *pipeline_state;
-    HRESULT hr;
-
     static const DWORD vs_code[] =
     {
 #if 0
@@ -268,18 +263,29 @@ static ID3D12PipelineState *create_pipeline_state_(unsigned int line, ID3D12Devi
     if (!ps)
         ps = &default_ps;
 
-    memset(&pipeline_state_desc, 0, sizeof(pipeline_state_desc));
-    pipeline_state_desc.pRootSignature = root_signature;
-    pipeline_state_desc.VS = vs;
-    pipeline_state_desc.PS = *ps;
-    pipeline_state_desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
-    pipeline_state_desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
-    pipeline_state_desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
-    pipeline_state_desc.SampleMask = ~(UINT)0;
-    pipeline_state_desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-    pipeline_state_desc.NumRenderTargets = 1;
-    pipeline_state_desc.RTVFormats[0] = rt_format;
-    pipeline_state_desc.SampleDesc.Count = 1;
+    memset(desc, 0, sizeof(*desc));
+    desc->pRootSignature = root_signature;
+    desc->VS = vs;
+    desc->PS = *ps;
+    desc->BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+    desc->RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+    desc->RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+    desc->SampleMask = ~(UINT)0;
+    desc->PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    desc->NumRenderTargets = 1;
+    desc->RTVFormats[0] = rt_format;
+    desc->SampleDesc.Count = 1;
+}
+
+#define create_pipeline_state(a, b, c, d) create_pipeline_state_(__LINE__, a, b, c, d)
+static ID3D12PipelineState *create_pipeline_state_(unsigned int line, ID3D12Device *device,
+        ID3D12RootSignature *root_signature, DXGI_FORMAT rt_format, const D3D12_SHADER_BYTECODE *ps)
+{
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC pipeline_state_desc;
+    ID3D12PipelineState *pipeline_state;
+    HRESULT hr;
+
+    init_pipeline_state_desc(&pipeline_state_desc, root_signature, rt_format, ps);
     hr = ID3D12Device_CreateGraphicsPipelineState(device, &pipeline_state_desc,
             &IID_ID3D12PipelineState, (void **)&pipeline_state);
     ok_(__FILE__, line)(hr == S_OK, "Failed to create graphics pipeline state, hr %#lx.\n", hr);
@@ -962,6 +968,79 @@ static void test_draw(void)
     destroy_test_context(&context);
 }
 
+static void test_cached_pipeline_state(void)
+{
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+    ID3D12RootSignature *root_signature;
+    ID3D12PipelineState *state;
+    ID3D12Device *device;
+    ID3DBlob *blob;
+    ULONG refcount;
+    HRESULT hr;
+
+    static const DWORD ps_code[] =
+    {
+#if 0
+        float4 color;
+
+        float4 main() : SV_Target
+        {
+            return color;
+        }
+#endif
+        0x43425844, 0x69e703c1, 0xf0db50aa, 0x9af7ae76, 0x623b93f7, 0x00000001, 0x000000bc, 0x00000003,
+        0x0000002c, 0x0000003c, 0x00000070, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000003, 0x00000000,
+        0x0000000f, 0x545f5653, 0x65677261, 0xabab0074, 0x58454853, 0x00000044, 0x00000050, 0x00000011,
+        0x0100086a, 0x04000059, 0x00208e46, 0x00000000, 0x00000001, 0x03000065, 0x001020f2, 0x00000000,
+        0x06000036, 0x001020f2, 0x00000000, 0x00208e46, 0x00000000, 0x00000000, 0x0100003e,
+    };
+    static const D3D12_SHADER_BYTECODE ps = {ps_code, sizeof(ps_code)};
+    static const DWORD invalid_blob[] = {0xdeadbeef, 0xdeadbeef, 0xdeadbeef, 0xdeadbeef};
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+    root_signature = create_default_root_signature(device);
+
+    init_pipeline_state_desc(&desc, root_signature, DXGI_FORMAT_R8G8B8A8_UNORM, NULL);
+    hr = ID3D12Device_CreateGraphicsPipelineState(device, &desc, &IID_ID3D12PipelineState, (void **)&state);
+    ok(hr == S_OK, "Got unexpected hr %#lx.\n", hr);
+
+    hr = ID3D12PipelineState_GetCachedBlob(state, &blob);
+    ok(hr == S_OK, "Got unexpected hr %#lx.\n", hr);
+    ok(ID3D10Blob_GetBufferSize(blob) > 0, "Got unexpected size %Iu.\n", ID3D10Blob_GetBufferSize(blob));
+    ID3D12PipelineState_Release(state);
+
+    /* The blob can be used to create the same pipeline state again. */
+    desc.CachedPSO.pCachedBlob = ID3D10Blob_GetBufferPointer(blob);
+    desc.CachedPSO.CachedBlobSizeInBytes = ID3D10Blob_GetBufferSize(blob);
+    hr = ID3D12Device_CreateGraphicsPipelineState(device, &desc, &IID_ID3D12PipelineState, (void **)&state);
+    ok(hr == S_OK, "Got unexpected hr %#lx.\n", hr);
+    ID3D12PipelineState_Release(state);
+
+    /* A blob created for different shaders is rejected. */
+    desc.PS = ps;
+    hr = ID3D12Device_CreateGraphicsPipelineState(device, &desc, &IID_ID3D12PipelineState, (void **)&state);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#lx.\n", hr);
+    if (SUCCEEDED(hr))
+        ID3D12PipelineState_Release(state);
+
+    desc.CachedPSO.pCachedBlob = invalid_blob;
+    desc.CachedPSO.CachedBlobSizeInBytes = sizeof(invalid_blob);
+    hr = ID3D12Device_CreateGraphicsPipelineState(device, &desc, &IID_ID3D12PipelineState, (void **)&state);
+    ok(FAILED(hr), "Got unexpected hr %#lx.\n", hr);
+    if (SUCCEEDED(hr))
+        ID3D12PipelineState_Release(state);
+
+    ID3D10Blob_Release(blob);
+    ID3D12RootSignature_Release(root_signature);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %lu references left.\n", refcount);
+}
+
 static void test_swapchain_draw(void)
 {
     static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
@@ -1445,6 +1524,7 @@ START_TEST(d3d12)
     test_interfaces();
     test_create_device();
     test_draw();
+    test_cached_pipeline_state();
     test_swapchain_draw();
     test_swapchain_refcount();
     test_swapchain_size_mismatch();
@@ -278,6 +278,7 @@ struct d3dx_regstore
 };
 
 struct d3dx_pres_ins;
+struct d3dx_pres_cins;
 
 struct d3dx_preshader
 {
@@ -286,6 +287,11 @@ struct d3dx_preshader
     unsigned int ins_count;
     struct d3dx_pres_ins *ins;
 
+    /* Compiled form of the instructions, see compile_preshader(). */
+    unsigned int code_count;
+    struct d3dx_pres_cins *code;
+    double *code_consts;
+
     struct d3dx_const_tab inputs;
 };
 
@@ -24,6 +24,9 @@
 
 
 #include <float.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 #include "d3dx9_private.h"
 
@@ -390,20 +393,46 @@ D3DXMATRIX * WINAPI D3DXMatrixLookAtRH(D3DXMATRIX *out, const D3DXVECTOR3 *eye,
     return out;
 }
 
-D3DXMATRIX* WINAPI D3DXMatrixMultiply(D3DXMATRIX *pout, const D3DXMATRIX *pm1, const D3DXMATRIX *pm2)
+#ifdef __SSE__
+/* Each row of the result is a linear combination of the rows of m2, summed in
+ * the same order as the C version. */
+static void matrix_multiply(D3DXMATRIX *out, const D3DXMATRIX *m1, const D3DXMATRIX *m2)
 {
-    D3DXMATRIX out;
-    int i,j;
+    __m128 r0 = _mm_loadu_ps(m2->m[0]), r1 = _mm_loadu_ps(m2->m[1]);
+    __m128 r2 = _mm_loadu_ps(m2->m[2]), r3 = _mm_loadu_ps(m2->m[3]);
+    __m128 row;
+    unsigned int i;
 
-    TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
+    for (i = 0; i < 4; ++i)
+    {
+        row = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m1->m[i][0]), r0), _mm_mul_ps(_mm_set1_ps(m1->m[i][1]), r1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(m1->m[i][2]), r2));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(m1->m[i][3]), r3));
+        _mm_storeu_ps(out->m[i], row);
+    }
+}
+#else
+static void matrix_multiply(D3DXMATRIX *out, const D3DXMATRIX *m1, const D3DXMATRIX *m2)
+{
+    int i,j;
 
     for (i=0; i<4; i++)
     {
         for (j=0; j<4; j++)
         {
-            out.m[i][j] = pm1->m[i][0] * pm2->m[0][j] + pm1->m[i][1] * pm2->m[1][j] + pm1->m[i][2] * pm2->m[2][j] + pm1->m[i][3] * pm2->m[3][j];
+            out->m[i][j] = m1->m[i][0] * m2->m[0][j] + m1->m[i][1] * m2->m[1][j] + m1->m[i][2] * m2->m[2][j] + m1->m[i][3] * m2->m[3][j];
         }
     }
+}
+#endif
+
+D3DXMATRIX* WINAPI D3DXMatrixMultiply(D3DXMATRIX *pout, const D3DXMATRIX *pm1, const D3DXMATRIX *pm2)
+{
+    D3DXMATRIX out;
+
+    TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
+
+    matrix_multiply(&out, pm1, pm2);
 
     *pout = out;
     return pout;
@@ -1823,40 +1852,156 @@ D3DXVECTOR3* WINAPI D3DXVec3Normalize(D3DXVECTOR3 *pout, const D3DXVECTOR3 *pv)
     return pout;
 }
 
+/* Array transforms. With SSE, the four components of the result are computed
+ * at once, in the same order as the C versions. */
+#ifdef __SSE__
+static inline __m128 vec3_transform_sse(const D3DXVECTOR3 *v, const __m128 *rows)
+{
+    __m128 out;
+
+    out = _mm_add_ps(_mm_mul_ps(rows[0], _mm_set1_ps(v->x)), _mm_mul_ps(rows[1], _mm_set1_ps(v->y)));
+    out = _mm_add_ps(out, _mm_mul_ps(rows[2], _mm_set1_ps(v->z)));
+    return _mm_add_ps(out, rows[3]);
+}
+
+static void load_matrix_rows(__m128 *rows, const D3DXMATRIX *matrix)
+{
+    rows[0] = _mm_loadu_ps(matrix->m[0]);
+    rows[1] = _mm_loadu_ps(matrix->m[1]);
+    rows[2] = _mm_loadu_ps(matrix->m[2]);
+    rows[3] = _mm_loadu_ps(matrix->m[3]);
+}
+
+static void vec3_transform_array(D3DXVECTOR4 *out, UINT outstride, const D3DXVECTOR3 *in, UINT instride,
+        const D3DXMATRIX *matrix, UINT elements)
+{
+    __m128 rows[4];
+    UINT i;
+
+    load_matrix_rows(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        __m128 v = vec3_transform_sse((const D3DXVECTOR3 *)((const char *)in + instride * i), rows);
+
+        _mm_storeu_ps(&((D3DXVECTOR4 *)((char *)out + outstride * i))->x, v);
+    }
+}
+
+static void vec3_transform_coord_array(D3DXVECTOR3 *out, UINT outstride, const D3DXVECTOR3 *in, UINT instride,
+        const D3DXMATRIX *matrix, UINT elements)
+{
+    __m128 rows[4];
+    UINT i;
+
+    load_matrix_rows(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        __m128 v = vec3_transform_sse((const D3DXVECTOR3 *)((const char *)in + instride * i), rows);
+        D3DXVECTOR3 *o = (D3DXVECTOR3 *)((char *)out + outstride * i);
+
+        v = _mm_div_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+        _mm_storel_pi((__m64 *)&o->x, v);
+        _mm_store_ss(&o->z, _mm_movehl_ps(v, v));
+    }
+}
+
+static void vec4_transform_array(D3DXVECTOR4 *out, UINT outstride, const D3DXVECTOR4 *in, UINT instride,
+        const D3DXMATRIX *matrix, UINT elements)
+{
+    __m128 rows[4], v;
+    UINT i;
+
+    load_matrix_rows(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR4 *pv = (const D3DXVECTOR4 *)((const char *)in + instride * i);
+
+        v = _mm_add_ps(_mm_mul_ps(rows[0], _mm_set1_ps(pv->x)), _mm_mul_ps(rows[1], _mm_set1_ps(pv->y)));
+        v = _mm_add_ps(v, _mm_mul_ps(rows[2], _mm_set1_ps(pv->z)));
+        v = _mm_add_ps(v, _mm_mul_ps(rows[3], _mm_set1_ps(pv->w)));
+        _mm_storeu_ps(&((D3DXVECTOR4 *)((char *)out + outstride * i))->x, v);
+    }
+}
+#else
+static void vec3_transform_array(D3DXVECTOR4 *out, UINT outstride, const D3DXVECTOR3 *in, UINT instride,
+        const D3DXMATRIX *matrix, UINT elements)
+{
+    UINT i;
+
+    for (i = 0; i < elements; ++i)
+        D3DXVec3Transform((D3DXVECTOR4 *)((char *)out + outstride * i),
+                (const D3DXVECTOR3 *)((const char *)in + instride * i), matrix);
+}
+
+static void vec3_transform_coord_array(D3DXVECTOR3 *out, UINT outstride, const D3DXVECTOR3 *in, UINT instride,
+        const D3DXMATRIX *matrix, UINT elements)
+{
+    UINT i;
+
+    for (i = 0; i < elements; ++i)
+        D3DXVec3TransformCoord((D3DXVECTOR3 *)((char *)out + outstride * i),
+                (const D3DXVECTOR3 *)((const char *)in + instride * i), matrix);
+}
+
+static void vec4_transform_array(D3DXVECTOR4 *out, UINT outstride, const D3DXVECTOR4 *in, UINT instride,
+        const D3DXMATRIX *matrix, UINT elements)
+{
+    UINT i;
+
+    for (i = 0; i < elements; ++i)
+        D3DXVec4Transform((D3DXVECTOR4 *)((char *)out + outstride * i),
+                (const D3DXVECTOR4 *)((const char *)in + instride * i), matrix);
+}
+#endif
+
+static void get_world_view_projection(D3DXMATRIX *m, const D3DXMATRIX *projection,
+        const D3DXMATRIX *view, const D3DXMATRIX *world)
+{
+    D3DXMatrixIdentity(m);
+    if (world) D3DXMatrixMultiply(m, m, world);
+    if (view) D3DXMatrixMultiply(m, m, view);
+    if (projection) D3DXMatrixMultiply(m, m, projection);
+}
+
+static void viewport_project(D3DXVECTOR3 *v, const D3DVIEWPORT9 *viewport)
+{
+    v->x = viewport->X +  ( 1.0f + v->x ) * viewport->Width / 2.0f;
+    v->y = viewport->Y +  ( 1.0f - v->y ) * viewport->Height / 2.0f;
+    v->z = viewport->MinZ + v->z * ( viewport->MaxZ - viewport->MinZ );
+}
+
 D3DXVECTOR3* WINAPI D3DXVec3Project(D3DXVECTOR3 *pout, const D3DXVECTOR3 *pv, const D3DVIEWPORT9 *pviewport, const D3DXMATRIX *pprojection, const D3DXMATRIX *pview, const D3DXMATRIX *pworld)
 {
     D3DXMATRIX m;
 
     TRACE("pout %p, pv %p, pviewport %p, pprojection %p, pview %p, pworld %p\n", pout, pv, pviewport, pprojection, pview, pworld);
 
-    D3DXMatrixIdentity(&m);
-    if (pworld) D3DXMatrixMultiply(&m, &m, pworld);
-    if (pview) D3DXMatrixMultiply(&m, &m, pview);
-    if (pprojection) D3DXMatrixMultiply(&m, &m, pprojection);
+    get_world_view_projection(&m, pprojection, pview, pworld);
 
     D3DXVec3TransformCoord(pout, pv, &m);
 
     if (pviewport)
-    {
-        pout->x = pviewport->X +  ( 1.0f + pout->x ) * pviewport->Width / 2.0f;
-        pout->y = pviewport->Y +  ( 1.0f - pout->y ) * pviewport->Height / 2.0f;
-        pout->z = pviewport->MinZ + pout->z * ( pviewport->MaxZ - pviewport->MinZ );
-    }
+        viewport_project(pout, pviewport);
     return pout;
 }
 
 D3DXVECTOR3* WINAPI D3DXVec3ProjectArray(D3DXVECTOR3* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DVIEWPORT9* viewport, const D3DXMATRIX* projection, const D3DXMATRIX* view, const D3DXMATRIX* world, UINT elements)
 {
+    D3DXMATRIX m;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, viewport %p, projection %p, view %p, world %p, elements %u\n",
         out, outstride, in, instride, viewport, projection, view, world, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec3Project(
-            (D3DXVECTOR3*)((char*)out + outstride * i),
-            (const D3DXVECTOR3*)((const char*)in + instride * i),
-            viewport, projection, view, world);
+    /* The matrix is the same for all the elements. */
+    get_world_view_projection(&m, projection, view, world);
+
+    vec3_transform_coord_array(out, outstride, in, instride, &m, elements);
+
+    if (viewport)
+    {
+        for (i = 0; i < elements; ++i)
+            viewport_project((D3DXVECTOR3 *)((char *)out + outstride * i), viewport);
     }
     return out;
 }
@@ -1877,16 +2022,9 @@ D3DXVECTOR4* WINAPI D3DXVec3Transform(D3DXVECTOR4 *pout, const D3DXVECTOR3 *pv,
 
 D3DXVECTOR4* WINAPI D3DXVec3TransformArray(D3DXVECTOR4* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
-    UINT i;
-
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec3Transform(
-            (D3DXVECTOR4*)((char*)out + outstride * i),
-            (const D3DXVECTOR3*)((const char*)in + instride * i),
-            matrix);
-    }
+    vec3_transform_array(out, outstride, in, instride, matrix, elements);
     return out;
 }
 
@@ -1910,16 +2048,9 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformCoord(D3DXVECTOR3 *pout, const D3DXVECTOR3
 
 D3DXVECTOR3* WINAPI D3DXVec3TransformCoordArray(D3DXVECTOR3* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
-    UINT i;
-
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec3TransformCoord(
-            (D3DXVECTOR3*)((char*)out + outstride * i),
-            (const D3DXVECTOR3*)((const char*)in + instride * i),
-            matrix);
-    }
+    vec3_transform_coord_array(out, outstride, in, instride, matrix, elements);
     return out;
 }
 
@@ -1951,6 +2082,13 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformNormalArray(D3DXVECTOR3* out, UINT outstrid
     return out;
 }
 
+static void viewport_unproject(D3DXVECTOR3 *v, const D3DVIEWPORT9 *viewport)
+{
+    v->x = 2.0f * (v->x - viewport->X) / viewport->Width - 1.0f;
+    v->y = 1.0f - 2.0f * (v->y - viewport->Y) / viewport->Height;
+    v->z = (v->z - viewport->MinZ) / (viewport->MaxZ - viewport->MinZ);
+}
+
 D3DXVECTOR3 * WINAPI D3DXVec3Unproject(D3DXVECTOR3 *out, const D3DXVECTOR3 *v,
         const D3DVIEWPORT9 *viewport, const D3DXMATRIX *projection, const D3DXMATRIX *view,
         const D3DXMATRIX *world)
@@ -1960,38 +2098,36 @@ D3DXVECTOR3 * WINAPI D3DXVec3Unproject(D3DXVECTOR3 *out, const D3DXVECTOR3 *v,
     TRACE("out %p, v %p, viewport %p, projection %p, view %p, world %p.\n",
             out, v, viewport, projection, view, world);
 
-    D3DXMatrixIdentity(&m);
-    if (world)
-        D3DXMatrixMultiply(&m, &m, world);
-    if (view)
-        D3DXMatrixMultiply(&m, &m, view);
-    if (projection)
-        D3DXMatrixMultiply(&m, &m, projection);
+    get_world_view_projection(&m, projection, view, world);
     D3DXMatrixInverse(&m, NULL, &m);
 
     *out = *v;
     if (viewport)
-    {
-        out->x = 2.0f * (out->x - viewport->X) / viewport->Width - 1.0f;
-        out->y = 1.0f - 2.0f * (out->y - viewport->Y) / viewport->Height;
-        out->z = (out->z - viewport->MinZ) / (viewport->MaxZ - viewport->MinZ);
-    }
+        viewport_unproject(out, viewport);
     D3DXVec3TransformCoord(out, out, &m);
     return out;
 }
 
 D3DXVECTOR3* WINAPI D3DXVec3UnprojectArray(D3DXVECTOR3* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DVIEWPORT9* viewport, const D3DXMATRIX* projection, const D3DXMATRIX* view, const D3DXMATRIX* world, UINT elements)
 {
+    D3DXMATRIX m;
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, viewport %p, projection %p, view %p, world %p, elements %u\n",
         out, outstride, in, instride, viewport, projection, view, world, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec3Unproject(
-            (D3DXVECTOR3*)((char*)out + outstride * i),
-            (const D3DXVECTOR3*)((const char*)in + instride * i),
-            viewport, projection, view, world);
+    /* The matrix is the same for all the elements. */
+    get_world_view_projection(&m, projection, view, world);
+    D3DXMatrixInverse(&m, NULL, &m);
+
+    for (i = 0; i < elements; ++i)
+    {
+        D3DXVECTOR3 *o = (D3DXVECTOR3 *)((char *)out + outstride * i);
+
+        *o = *(const D3DXVECTOR3 *)((const char *)in + instride * i);
+        if (viewport)
+            viewport_unproject(o, viewport);
+        D3DXVec3TransformCoord(o, o, &m);
     }
     return out;
 }
@@ -2084,16 +2220,9 @@ D3DXVECTOR4* WINAPI D3DXVec4Transform(D3DXVECTOR4 *pout, const D3DXVECTOR4 *pv,
 
 D3DXVECTOR4* WINAPI D3DXVec4TransformArray(D3DXVECTOR4* out, UINT outstride, const D3DXVECTOR4* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
-    UINT i;
-
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
-    for (i = 0; i < elements; ++i) {
-        D3DXVec4Transform(
-            (D3DXVECTOR4*)((char*)out + outstride * i),
-            (const D3DXVECTOR4*)((const char*)in + instride * i),
-            matrix);
-    }
+    vec4_transform_array(out, outstride, in, instride, matrix, elements);
     return out;
 }
 
@@ -257,6 +257,86 @@ struct d3dx_pres_ins
     struct d3dx_pres_operand output;
 };
 
+/* A compiled preshader instruction input. Immediate and floating point
+ * register inputs without relative addressing are read directly through a
+ * pointer, everything else goes through exec_get_arg(). Component j is read
+ * from component "comp + step * j" of the operand. */
+struct d3dx_pres_carg
+{
+    const double *d;
+    const float *f;
+    const struct d3dx_pres_operand *opr;
+    unsigned int comp, step;
+};
+
+/* A compiled preshader instruction. component_count components are computed
+ * for all the inputs at once, and written to the output starting at
+ * out_comp. */
+struct d3dx_pres_cins
+{
+    enum pres_ops op;
+    unsigned int component_count;
+    struct d3dx_pres_carg inputs[MAX_INPUTS_COUNT];
+    float *out_f;
+    const struct d3dx_pres_reg *out_reg;
+    unsigned int out_comp;
+};
+
+/* Evaluate an instruction, given the input values of each component.
+ * Returns the number of output components. This gives the same results as
+ * calling the pres_op_func of the instruction for each component. */
+static unsigned int pres_eval_ins(enum pres_ops op, unsigned int count,
+        double args[][MAX_INPUTS_COUNT], double *res)
+{
+    double dot_args[MAX_INPUTS_COUNT];
+    unsigned int j;
+
+    switch (op)
+    {
+        case PRESHADER_OP_MOV:
+            for (j = 0; j < count; ++j)
+                res[j] = args[j][0];
+            break;
+        case PRESHADER_OP_NEG:
+            for (j = 0; j < count; ++j)
+                res[j] = -args[j][0];
+            break;
+        case PRESHADER_OP_ADD:
+            for (j = 0; j < count; ++j)
+                res[j] = args[j][0] + args[j][1];
+            break;
+        case PRESHADER_OP_MUL:
+            for (j = 0; j < count; ++j)
+                res[j] = args[j][0] * args[j][1];
+            break;
+        case PRESHADER_OP_LT:
+            for (j = 0; j < count; ++j)
+                res[j] = args[j][0] < args[j][1] ? 1.0 : 0.0;
+            break;
+        case PRESHADER_OP_GE:
+            for (j = 0; j < count; ++j)
+                res[j] = args[j][0] >= args[j][1] ? 1.0 : 0.0;
+            break;
+        case PRESHADER_OP_CMP:
+            for (j = 0; j < count; ++j)
+                res[j] = args[j][0] >= 0.0 ? args[j][1] : args[j][2];
+            break;
+        case PRESHADER_OP_DOT:
+            for (j = 0; j < count; ++j)
+            {
+                dot_args[j] = args[j][0];
+                dot_args[j + count] = args[j][1];
+            }
+            res[0] = pres_dot(dot_args, count);
+            return 1;
+        default:
+            for (j = 0; j < count; ++j)
+                res[j] = pres_op_info[op].func(args[j], count);
+            break;
+    }
+    return count;
+}
+
 struct const_upload_info
 {
     BOOL transpose;
@@ -1220,6 +1300,273 @@ static HRESULT parse_preshader(struct d3dx_preshader *pres, unsigned int *ptr, u
     return D3D_OK;
 }
 
+/* Whether reading the inputs of all the components before writing any of
+ * the outputs would give a different result than evaluating the instruction
+ * one component at a time, because a component reads the output of a
+ * previous one. */
+static BOOL pres_ins_needs_serial_eval(const struct d3dx_pres_ins *ins)
+{
+    const struct d3dx_pres_reg *out = &ins->output.reg;
+    unsigned int j, k, offset;
+
+    if (pres_op_info[ins->op].func_all_comps)
+        return FALSE;
+
+    for (k = 0; k < pres_op_info[ins->op].input_count; ++k)
+    {
+        const struct d3dx_pres_operand *opr = &ins->inputs[k];
+
+        for (j = 1; j < ins->component_count; ++j)
+        {
+            if (opr->index_reg.table == out->table && opr->index_reg.offset >= out->offset
+                    && opr->index_reg.offset < out->offset + j)
+                return TRUE;
+            if (opr->reg.table != out->table)
+                continue;
+            if (opr->index_reg.table != PRES_REGTAB_COUNT)
+                return TRUE;
+            offset = opr->reg.offset + (ins->scalar_op && !k ? 0 : j);
+            if (offset >= out->offset && offset < out->offset + j)
+                return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void compile_pres_arg(struct d3dx_regstore *rs, const struct d3dx_pres_operand *opr,
+        BOOL scalar, unsigned int first, struct d3dx_pres_carg *arg)
+{
+    unsigned int table = opr->reg.table;
+
+    arg->opr = opr;
+    arg->comp = scalar ? 0 : first;
+    arg->step = scalar ? 0 : 1;
+    if (opr->index_reg.table != PRES_REGTAB_COUNT)
+        return;
+    /* The register index has been validated by parse_preshader(). */
+    if (table == PRES_REGTAB_IMMED)
+        arg->d = (const double *)rs->tables[table] + opr->reg.offset;
+    else if (table_info[table].type == PRES_VT_FLOAT)
+        arg->f = (const float *)rs->tables[table] + opr->reg.offset;
+}
+
+/* Temporary register components whose value is known at compile time. */
+struct pres_known_temps
+{
+    BOOL *known;
+    double *values;
+    unsigned int count;
+};
+
+static BOOL pres_arg_get_known(const struct d3dx_pres_carg *arg, const struct pres_known_temps *temps,
+        unsigned int j, double *value)
+{
+    unsigned int comp = arg->comp + arg->step * j;
+
+    if (arg->d)
+    {
+        *value = arg->d[comp];
+        return TRUE;
+    }
+    if (arg->f && arg->opr->reg.table == PRES_REGTAB_TEMP && temps->known[arg->opr->reg.offset + comp])
+    {
+        *value = temps->values[arg->opr->reg.offset + comp];
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static unsigned int pres_cins_output_count(const struct d3dx_pres_cins *cins)
+{
+    return pres_op_info[cins->op].func_all_comps ? 1 : cins->component_count;
+}
+
+/* Replace the instruction with a move from constants if all of its inputs
+ * are known, and keep track of the known temporary registers. */
+static void fold_pres_cins(struct d3dx_preshader *pres, struct d3dx_pres_cins *cins,
+        struct pres_known_temps *temps, unsigned int *const_count)
+{
+    double args[4][MAX_INPUTS_COUNT], res[4];
+    unsigned int j, k, out_count;
+    BOOL folded = TRUE;
+
+    for (j = 0; j < cins->component_count && folded; ++j)
+    {
+        for (k = 0; k < pres_op_info[cins->op].input_count && folded; ++k)
+            folded = pres_arg_get_known(&cins->inputs[k], temps, j, &args[j][k]);
+    }
+
+    if (folded)
+    {
+        out_count = pres_eval_ins(cins->op, cins->component_count, args, res);
+        memset(cins->inputs, 0, sizeof(cins->inputs));
+        cins->op = PRESHADER_OP_MOV;
+        cins->component_count = out_count;
+        cins->inputs[0].d = pres->code_consts + *const_count;
+        cins->inputs[0].step = 1;
+        memcpy(pres->code_consts + *const_count, res, out_count * sizeof(*res));
+        *const_count += out_count;
+    }
+    else
+    {
+        out_count = pres_cins_output_count(cins);
+    }
+
+    if (cins->out_reg->table != PRES_REGTAB_TEMP)
+        return;
+    for (j = 0; j < out_count; ++j)
+    {
+        temps->known[cins->out_reg->offset + cins->out_comp + j] = folded;
+        /* Temporary registers are stored as floats. */
+        if (folded)
+            temps->values[cins->out_reg->offset + cins->out_comp + j] = (float)res[j];
+    }
+}
+
+/* Remove the instructions only writing temporary register components which
+ * are overwritten before being read. Temporary registers keep their values
+ * between executions, so components read anywhere in the program are live
+ * at its end. */
+static void eliminate_dead_pres_code(struct d3dx_preshader *pres, BOOL *live, unsigned int temp_count)
+{
+    struct d3dx_pres_cins *cins;
+    unsigned int i, j, k, count;
+    BOOL dead;
+
+    memset(live, 0, temp_count * sizeof(*live));
+    for (i = 0; i < pres->code_count; ++i)
+    {
+        cins = &pres->code[i];
+        for (k = 0; k < pres_op_info[cins->op].input_count; ++k)
+        {
+            const struct d3dx_pres_carg *arg = &cins->inputs[k];
+
+            if (!arg->opr)
+                continue;
+            /* Relative addressing could read any of them. */
+            if (arg->opr->index_reg.table == PRES_REGTAB_TEMP
+                    || (arg->opr->reg.table == PRES_REGTAB_TEMP && !arg->f))
+                return;
+            if (arg->opr->reg.table == PRES_REGTAB_TEMP)
+            {
+                for (j = 0; j < cins->component_count; ++j)
+                    live[arg->opr->reg.offset + arg->comp + arg->step * j] = TRUE;
+            }
+        }
+    }
+
+    for (i = pres->code_count; i--;)
+    {
+        cins = &pres->code[i];
+        count = pres_cins_output_count(cins);
+        if (cins->out_reg->table == PRES_REGTAB_TEMP)
+        {
+            dead = TRUE;
+            for (j = 0; j < count; ++j)
+            {
+                dead &= !live[cins->out_reg->offset + cins->out_comp + j];
+                live[cins->out_reg->offset + cins->out_comp + j] = FALSE;
+            }
+            if (dead)
+            {
+                cins->op = PRESHADER_OP_NOP;
+                continue;
+            }
+        }
+        for (k = 0; k < pres_op_info[cins->op].input_count; ++k)
+        {
+            const struct d3dx_pres_carg *arg = &cins->inputs[k];
+
+            if (!arg->opr || arg->opr->reg.table != PRES_REGTAB_TEMP)
+                continue;
+            for (j = 0; j < cins->component_count; ++j)
+                live[arg->opr->reg.offset + arg->comp + arg->step * j] = TRUE;
+        }
+    }
+
+    for (i = j = 0; i < pres->code_count; ++i)
+    {
+        if (pres->code[i].op != PRESHADER_OP_NOP)
+            pres->code[j++] = pres->code[i];
+    }
+    pres->code_count = j;
+}
+
+/* Translate the instructions to a form which can be executed without
+ * decoding the operands for every component: operands are resolved to
+ * register pointers, all the components of an instruction are evaluated at
+ * once, instructions with constant inputs are folded and instructions with
+ * unused results are removed. The results are the same as with
+ * execute_preshader(), which is kept as the reference implementation. */
+static HRESULT compile_preshader(struct d3dx_preshader *pres)
+{
+    struct d3dx_regstore *rs = &pres->regs;
+    unsigned int i, j, k, count, first, const_count = 0;
+    struct pres_known_temps temps;
+    struct d3dx_pres_cins *cins;
+    BOOL serial;
+
+    if (!pres->ins_count)
+        return D3D_OK;
+
+    /* Instructions are split into at most 4 single component ones. */
+    if (!(pres->code = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, pres->ins_count * 4 * sizeof(*pres->code))))
+        return E_OUTOFMEMORY;
+    if (!(pres->code_consts = HeapAlloc(GetProcessHeap(), 0, pres->ins_count * 4 * sizeof(*pres->code_consts))))
+        return E_OUTOFMEMORY;
+
+    temps.count = get_offset_reg(PRES_REGTAB_TEMP, rs->table_sizes[PRES_REGTAB_TEMP]);
+    temps.known = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, (temps.count + 1) * sizeof(*temps.known));
+    temps.values = HeapAlloc(GetProcessHeap(), 0, (temps.count + 1) * sizeof(*temps.values));
+    if (!temps.known || !temps.values)
+    {
+        HeapFree(GetProcessHeap(), 0, temps.known);
+        HeapFree(GetProcessHeap(), 0, temps.values);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < pres->ins_count; ++i)
+    {
+        const struct d3dx_pres_ins *ins = &pres->ins[i];
+        const struct op_info *oi = &pres_op_info[ins->op];
+
+        if (ins->op == PRESHADER_OP_NOP)
+            continue;
+
+        serial = pres_ins_needs_serial_eval(ins);
+        count = serial ? 1 : ins->component_count;
+        for (first = 0; first < ins->component_count; first += count)
+        {
+            cins = &pres->code[pres->code_count++];
+            cins->op = ins->op;
+            cins->component_count = count;
+            for (k = 0; k < oi->input_count; ++k)
+                compile_pres_arg(rs, &ins->inputs[k], ins->scalar_op && !k, first, &cins->inputs[k]);
+            cins->out_reg = &ins->output.reg;
+            cins->out_comp = first;
+            fold_pres_cins(pres, cins, &temps, &const_count);
+        }
+    }
+
+    /* The known flags aren't needed anymore, use them for liveness. */
+    eliminate_dead_pres_code(pres, temps.known, temps.count);
+
+    for (i = 0; i < pres->code_count; ++i)
+    {
+        cins = &pres->code[i];
+        if (table_info[cins->out_reg->table].type == PRES_VT_FLOAT)
+            cins->out_f = (float *)rs->tables[cins->out_reg->table] + cins->out_reg->offset + cins->out_comp;
+    }
+
+    HeapFree(GetProcessHeap(), 0, temps.known);
+    HeapFree(GetProcessHeap(), 0, temps.values);
+
+    for (i = j = 0; i < pres->code_count; ++i)
+        j += pres->code[i].op == PRESHADER_OP_MOV && pres->code[i].inputs[0].d && !pres->code[i].inputs[0].opr;
+    TRACE("Compiled %u preshader instructions to %u, %u folded.\n", pres->ins_count, pres->code_count, j);
+    return D3D_OK;
+}
+
 HRESULT d3dx_create_param_eval(struct d3dx_effect *effect, void *byte_code, unsigned int byte_code_size,
         D3DXPARAMETER_TYPE type, struct d3dx_param_eval **peval_out, ULONG64 *version_counter,
         const char **skip_constants, unsigned int skip_constants_count)
@@ -1306,6 +1653,9 @@ HRESULT d3dx_create_param_eval(struct d3dx_effect *effect, void *byte_code, unsi
             goto err_out;
     }
 
+    if (FAILED(ret = compile_preshader(&peval->pres)))
+        goto err_out;
+
     if (TRACE_ON(d3dx))
     {
         dump_bytecode(byte_code, byte_code_size);
@@ -1340,6 +1690,8 @@ static void d3dx_free_const_tab(struct d3dx_const_tab *ctab)
 static void d3dx_free_preshader(struct d3dx_preshader *pres)
 {
     HeapFree(GetProcessHeap(), 0, pres->ins);
+    HeapFree(GetProcessHeap(), 0, pres->code);
+    HeapFree(GetProcessHeap(), 0, pres->code_consts);
 
     regstore_free_tables(&pres->regs);
     d3dx_free_const_tab(&pres->inputs);
@@ -1689,6 +2041,84 @@ static HRESULT execute_preshader(struct d3dx_preshader *pres)
     return D3D_OK;
 }
 
+static double exec_get_carg(struct d3dx_regstore *rs, const struct d3dx_pres_carg *arg, unsigned int j)
+{
+    unsigned int comp = arg->comp + arg->step * j;
+
+    if (arg->d)
+        return arg->d[comp];
+    if (arg->f)
+        return arg->f[comp];
+    return exec_get_arg(rs, arg->opr, comp);
+}
+
+static void execute_compiled_preshader(struct d3dx_preshader *pres)
+{
+    double args[4][MAX_INPUTS_COUNT], res[4];
+    unsigned int i, j, k, count;
+
+    for (i = 0; i < pres->code_count; ++i)
+    {
+        const struct d3dx_pres_cins *cins = &pres->code[i];
+        unsigned int input_count = pres_op_info[cins->op].input_count;
+
+        for (j = 0; j < cins->component_count; ++j)
+        {
+            for (k = 0; k < input_count; ++k)
+                args[j][k] = exec_get_carg(&pres->regs, &cins->inputs[k], j);
+        }
+        count = pres_eval_ins(cins->op, cins->component_count, args, res);
+        if (cins->out_f)
+        {
+            for (j = 0; j < count; ++j)
+                cins->out_f[j] = res[j];
+        }
+        else
+        {
+            for (j = 0; j < count; ++j)
+                exec_set_arg(&pres->regs, cins->out_reg, cins->out_comp + j, res[j]);
+        }
+    }
+}
+
+/* When tracing, run the interpreter after the compiled code and check that
+ * the outputs match. */
+static HRESULT run_preshader(struct d3dx_preshader *pres)
+{
+    static const enum pres_reg_tables output_tables[] =
+            {PRES_REGTAB_OCONST, PRES_REGTAB_OBCONST, PRES_REGTAB_OICONST};
+    struct d3dx_regstore *rs = &pres->regs;
+    void *outputs[ARRAY_SIZE(output_tables)];
+    unsigned int i, size[ARRAY_SIZE(output_tables)];
+    HRESULT hr;
+
+    if (!pres->code)
+        return execute_preshader(pres);
+
+    execute_compiled_preshader(pres);
+    if (!TRACE_ON(d3dx))
+        return D3D_OK;
+
+    for (i = 0; i < ARRAY_SIZE(output_tables); ++i)
+    {
+        size[i] = get_offset_reg(output_tables[i], rs->table_sizes[output_tables[i]])
+                * table_info[output_tables[i]].component_size;
+        if ((outputs[i] = HeapAlloc(GetProcessHeap(), 0, size[i])))
+            memcpy(outputs[i], rs->tables[output_tables[i]], size[i]);
+    }
+    hr = execute_preshader(pres);
+    for (i = 0; i < ARRAY_SIZE(output_tables); ++i)
+    {
+        if (outputs[i] && memcmp(outputs[i], rs->tables[output_tables[i]], size[i]))
+        {
+            ERR("Compiled preshader %p output differs from the interpreter, table %u.\n", pres, output_tables[i]);
+            dump_preshader(pres);
+        }
+        HeapFree(GetProcessHeap(), 0, outputs[i]);
+    }
+    return hr;
+}
+
 static BOOL is_const_tab_input_dirty(struct d3dx_const_tab *ctab, ULONG64 update_version)
 {
     unsigned int i;
@@ -1726,7 +2156,7 @@ HRESULT d3dx_evaluate_parameter(struct d3dx_param_eval *peval, const struct d3dx
                 next_update_version(peval->version_counter),
                 NULL, NULL, peval->param_type, FALSE, FALSE);
 
-        if (FAILED(hr = execute_preshader(&peval->pres)))
+        if (FAILED(hr = run_preshader(&peval->pres)))
             return hr;
     }
 
@@ -1754,7 +2184,7 @@ HRESULT d3dx_param_eval_set_shader_constants(ID3DXEffectStateManager *manager, s
     {
         set_constants(rs, &pres->inputs, new_update_version,
                 NULL, NULL, peval->param_type, FALSE, FALSE);
-        if (FAILED(hr = execute_preshader(pres)))
+        if (FAILED(hr = run_preshader(pres)))
             return hr;
         pres_dirty = TRUE;
     }
@@ -1875,6 +1875,79 @@ void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slic
     }
 }
 
+/* Compressing to DXTn is expensive, so big surfaces are split in bands of
+ * block rows, compressed in parallel on the thread pool. */
+#define DXTN_COMPRESS_BAND_BLOCK_ROWS 16
+#define DXTN_COMPRESS_PARALLEL_MIN_PIXELS (256 * 256)
+
+struct dxtn_compress_job
+{
+    const BYTE *src;
+    BYTE *dst;
+    unsigned int width, height;
+    unsigned int dst_pitch;
+    GLenum format;
+    GLint dst_row_stride;
+    LONG next_band;
+    unsigned int band_count;
+};
+
+static void compress_dxtn_bands(struct dxtn_compress_job *job)
+{
+    unsigned int band, y, height;
+
+    while ((band = InterlockedIncrement(&job->next_band) - 1) < job->band_count)
+    {
+        y = band * DXTN_COMPRESS_BAND_BLOCK_ROWS * 4;
+        height = min(job->height - y, DXTN_COMPRESS_BAND_BLOCK_ROWS * 4);
+        tx_compress_dxtn(4, job->width, height, job->src + y * job->width * sizeof(DWORD),
+                job->format, job->dst + y / 4 * job->dst_pitch, job->dst_row_stride);
+    }
+}
+
+static void CALLBACK compress_dxtn_callback(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work)
+{
+    compress_dxtn_bands(context);
+}
+
+static void compress_dxtn(const BYTE *src, unsigned int width, unsigned int height, GLenum format,
+        BYTE *dst, unsigned int dst_pitch, GLint dst_row_stride, unsigned int block_byte_count)
+{
+    struct dxtn_compress_job job;
+    unsigned int i, thread_count;
+    SYSTEM_INFO info;
+    TP_WORK *work;
+
+    GetSystemInfo(&info);
+    job.band_count = (height + DXTN_COMPRESS_BAND_BLOCK_ROWS * 4 - 1) / (DXTN_COMPRESS_BAND_BLOCK_ROWS * 4);
+    thread_count = min(info.dwNumberOfProcessors, job.band_count);
+
+    /* The bands are only placed correctly when the rows of blocks are tightly
+     * packed, which is always the case for D3D surfaces. */
+    if (thread_count < 2 || width < 64 || width * height < DXTN_COMPRESS_PARALLEL_MIN_PIXELS
+            || dst_pitch != (width + 3) / 4 * block_byte_count
+            || !(work = CreateThreadpoolWork(compress_dxtn_callback, &job, NULL)))
+    {
+        tx_compress_dxtn(4, width, height, src, format, dst, dst_row_stride);
+        return;
+    }
+
+    TRACE("Compressing %ux%u pixels in %u bands on %u threads.\n", width, height, job.band_count, thread_count);
+    job.src = src;
+    job.dst = dst;
+    job.width = width;
+    job.height = height;
+    job.dst_pitch = dst_pitch;
+    job.format = format;
+    job.dst_row_stride = dst_row_stride;
+    job.next_band = 0;
+    for (i = 1; i < thread_count; ++i)
+        SubmitThreadpoolWork(work);
+    compress_dxtn_bands(&job);
+    WaitForThreadpoolWorkCallbacks(work, FALSE);
+    CloseThreadpoolWork(work);
+}
+
 /************************************************************
  * D3DXLoadSurfaceFromMemory
  *
@@ -2033,9 +2106,10 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
 
         if (srcformatdesc->type == FORMAT_DXT)
         {
-            void (*fetch_dxt_texel)(int srcRowStride, const BYTE *pixdata,
-                    int i, int j, void *texel);
-            unsigned int x, y;
+            void (*fetch_dxt_block)(int srcRowStride, const BYTE *pixdata,
+                    int i, int j, void *texels);
+            unsigned int x, y, block_x, block_y;
+            DWORD texels[16];
 
             src_pitch = src_pitch * srcformatdesc->block_width / srcformatdesc->block_byte_count;
 
@@ -2049,29 +2123,37 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
             switch(src_format)
             {
                 case D3DFMT_DXT1:
-                    fetch_dxt_texel = fetch_2d_texel_rgba_dxt1;
+                    fetch_dxt_block = fetch_2d_block_rgba_dxt1;
                     break;
                 case D3DFMT_DXT2:
                 case D3DFMT_DXT3:
-                    fetch_dxt_texel = fetch_2d_texel_rgba_dxt3;
+                    fetch_dxt_block = fetch_2d_block_rgba_dxt3;
                     break;
                 case D3DFMT_DXT4:
                 case D3DFMT_DXT5:
-                    fetch_dxt_texel = fetch_2d_texel_rgba_dxt5;
+                    fetch_dxt_block = fetch_2d_block_rgba_dxt5;
                     break;
                 default:
                     FIXME("Unexpected compressed texture format %u.\n", src_format);
-                    fetch_dxt_texel = NULL;
+                    fetch_dxt_block = NULL;
             }
 
+            /* Decode each block once, and copy the texels inside the source
+             * rectangle. */
             TRACE("Uncompressing DXTn surface.\n");
-            for (y = 0; y < src_size.height; ++y)
+            for (block_y = src_rect->top & ~3; block_y < src_rect->top + src_size.height; block_y += 4)
             {
-                DWORD *ptr = &src_uncompressed[y * src_size.width];
-                for (x = 0; x < src_size.width; ++x)
+                for (block_x = src_rect->left & ~3; block_x < src_rect->left + src_size.width; block_x += 4)
                 {
-                    fetch_dxt_texel(src_pitch, src_memory, x + src_rect->left, y + src_rect->top, ptr);
-                    ++ptr;
+                    fetch_dxt_block(src_pitch, src_memory, block_x, block_y, texels);
+                    for (y = max(block_y, src_rect->top); y < min(block_y + 4, src_rect->top + src_size.height); ++y)
+                    {
+                        DWORD *ptr = &src_uncompressed[(y - src_rect->top) * src_size.width];
+
+                        for (x = max(block_x, src_rect->left);
+                                x < min(block_x + 4, src_rect->left + src_size.width); ++x)
+                            ptr[x - src_rect->left] = texels[(y - block_y) * 4 + x - block_x];
+                    }
                 }
             }
             src_memory = src_uncompressed;
@@ -2145,9 +2227,10 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
                 default:
                     ERR("Unexpected destination compressed format %u.\n", surfdesc.Format);
             }
-            tx_compress_dxtn(4, dst_size_aligned.width, dst_size_aligned.height,
-                    dst_uncompressed, gl_format, lockrect.pBits,
-                    lockrect.Pitch * destformatdesc->block_width / destformatdesc->block_byte_count);
+            compress_dxtn(dst_uncompressed, dst_size_aligned.width, dst_size_aligned.height,
+                    gl_format, lockrect.pBits, lockrect.Pitch,
+                    lockrect.Pitch * destformatdesc->block_width / destformatdesc->block_byte_count,
+                    destformatdesc->block_byte_count);
             heap_free(dst_uncompressed);
         }
     }
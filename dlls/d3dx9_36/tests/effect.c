@@ -5145,6 +5145,101 @@ static void test_effect_preshader_ops(IDirect3DDevice9 *device)
     effect->lpVtbl->Release(effect);
 }
 
+/* Preshader replacing the one of LightAmbient[0] in test_effect_preshader_ops_blob, to test constant
+ * folding and dead code elimination. */
+static const DWORD test_effect_preshader_folding_clit_fxlc[] =
+{
+    0x0012fffe, 0x54494c43,
+    0x00000008, /* Immediate count. */
+    0x00000000, 0x40000000, 0x00000000, 0x40080000, 0x00000000, 0x3fe00000, 0x00000000, 0xbff00000,
+    0x00000000, 0x40240000, 0x00000000, 0x3fd00000, 0x00000000, 0x40100000, 0x00000000, 0x3ff00000,
+    0x0041fffe, 0x434c5846,
+    0x00000006, /* Instruction count. */
+    /* mov r0, imm0: folded, then removed since r0 is only read by a folded instruction. */
+    0x10000004, 0x00000001, 0x00000000, 0x00000001, 0x00000000, 0x00000000, 0x00000007, 0x00000000,
+    /* mul r1, r0, imm1: folded to r1 = {20, 0.75, 2, -1}. */
+    0x20500004, 0x00000002, 0x00000000, 0x00000007, 0x00000000, 0x00000000, 0x00000001, 0x00000004,
+    0x00000000, 0x00000007, 0x00000004,
+    /* add r2, c0, c1: removed since r2 is overwritten before being read. */
+    0x20400004, 0x00000002, 0x00000000, 0x00000002, 0x00000000, 0x00000000, 0x00000002, 0x00000004,
+    0x00000000, 0x00000007, 0x00000008,
+    /* mul r2, c0, r1 */
+    0x20500004, 0x00000002, 0x00000000, 0x00000002, 0x00000000, 0x00000000, 0x00000007, 0x00000004,
+    0x00000000, 0x00000007, 0x00000008,
+    /* mov oc0, r1: the output isn't a temporary register, this is kept. */
+    0x10000004, 0x00000001, 0x00000000, 0x00000007, 0x00000004, 0x00000000, 0x00000004, 0x00000000,
+    /* add oc0, r2, c2 */
+    0x20400004, 0x00000002, 0x00000000, 0x00000007, 0x00000008, 0x00000000, 0x00000002, 0x00000008,
+    0x00000000, 0x00000004, 0x00000000,
+    0xf0f0f0f0, 0x0f0f0f0f, 0x0000ffff,
+};
+
+static void test_effect_preshader_folding(IDirect3DDevice9 *device)
+{
+    /* Position of the LightAmbient[0] preshader in test_effect_preshader_ops_blob. */
+    static const unsigned int size_pos = 406, clit_pos = size_pos + 61, end_pos = size_pos + 91;
+    static D3DLIGHT9 light;
+    const struct
+    {
+        D3DXVECTOR4 opvect1, opvect2, opvect3;
+        D3DCOLORVALUE expected;
+    }
+    tests[] =
+    {
+        {{1.0f, 2.0f, 3.0f, 4.0f}, {5.0f, 6.0f, 7.0f, 8.0f}, {0.5f, 0.25f, -1.0f, 8.0f}, {20.5f, 1.75f, 5.0f, 4.0f}},
+        {{-1.0f, 0.0f, 0.5f, 2.0f}, {NAN, NAN, NAN, NAN}, {0.0f, 0.0f, 0.0f, 0.0f}, {-20.0f, 0.0f, 1.0f, -2.0f}},
+    };
+    unsigned int i, passes_count, blob_size;
+    ID3DXEffect *effect;
+    DWORD *blob;
+    HRESULT hr;
+
+    ok(test_effect_preshader_ops_blob[size_pos] == 0x16c
+            && test_effect_preshader_ops_blob[clit_pos] == 0x0002fffe
+            && test_effect_preshader_ops_blob[clit_pos + 3] == 0x001afffe,
+            "Unexpected blob layout.\n");
+
+    blob_size = sizeof(test_effect_preshader_ops_blob) + sizeof(test_effect_preshader_folding_clit_fxlc)
+            - (end_pos - clit_pos) * sizeof(DWORD);
+    blob = HeapAlloc(GetProcessHeap(), 0, blob_size);
+    memcpy(blob, test_effect_preshader_ops_blob, clit_pos * sizeof(DWORD));
+    memcpy(blob + clit_pos, test_effect_preshader_folding_clit_fxlc, sizeof(test_effect_preshader_folding_clit_fxlc));
+    memcpy(blob + clit_pos + ARRAY_SIZE(test_effect_preshader_folding_clit_fxlc),
+            test_effect_preshader_ops_blob + end_pos,
+            sizeof(test_effect_preshader_ops_blob) - end_pos * sizeof(DWORD));
+    blob[size_pos] += sizeof(test_effect_preshader_folding_clit_fxlc) - (end_pos - clit_pos) * sizeof(DWORD);
+
+    hr = D3DXCreateEffect(device, blob, blob_size, NULL, NULL, 0, NULL, &effect, NULL);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    hr = effect->lpVtbl->Begin(effect, &passes_count, 0);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    hr = effect->lpVtbl->BeginPass(effect, 0);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(tests); ++i)
+    {
+        hr = effect->lpVtbl->SetVector(effect, "opvect1", &tests[i].opvect1);
+        ok(hr == D3D_OK, "SetVector failed, hr %#x.\n", hr);
+        hr = effect->lpVtbl->SetVector(effect, "opvect2", &tests[i].opvect2);
+        ok(hr == D3D_OK, "SetVector failed, hr %#x.\n", hr);
+        hr = effect->lpVtbl->SetVector(effect, "opvect3", &tests[i].opvect3);
+        ok(hr == D3D_OK, "SetVector failed, hr %#x.\n", hr);
+        hr = effect->lpVtbl->CommitChanges(effect);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+        hr = IDirect3DDevice9_GetLight(device, 0, &light);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+        ok(!memcmp(&light.Ambient, &tests[i].expected, sizeof(light.Ambient)),
+                "Test %u: got unexpected value {%.8e, %.8e, %.8e, %.8e}.\n", i,
+                light.Ambient.r, light.Ambient.g, light.Ambient.b, light.Ambient.a);
+    }
+
+    hr = effect->lpVtbl->End(effect);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    effect->lpVtbl->Release(effect);
+    HeapFree(GetProcessHeap(), 0, blob);
+}
+
 static void test_isparameterused_children(unsigned int line, ID3DXEffect *effect,
         D3DXHANDLE tech, D3DXHANDLE param)
 {
@@ -8721,6 +8816,7 @@ START_TEST(effect)
     test_effect_states(device);
     test_effect_preshader(device);
     test_effect_preshader_ops(device);
+    test_effect_preshader_folding(device);
     test_effect_isparameterused(device);
     test_effect_out_of_bounds_selector(device);
     test_effect_commitchanges(device);
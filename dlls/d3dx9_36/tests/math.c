@@ -3248,6 +3248,100 @@ static void test_D3DXVec_Array(void)
     }
 }
 
+static void test_D3DXVec_Array_elements(void)
+{
+    struct
+    {
+        D3DXVECTOR4 v;
+        float pad;
+    }
+    in[37], out[37];
+    D3DXMATRIX mat, projection, view, world;
+    D3DXVECTOR3 vec3[37], exp3;
+    D3DXVECTOR4 exp4;
+    D3DVIEWPORT9 viewport;
+    unsigned int i;
+
+    viewport.Width = 640; viewport.MinZ = 0.0f; viewport.X = 3;
+    viewport.Height = 480; viewport.MaxZ = 1.0f; viewport.Y = 7;
+
+    /* Compare the array functions with the single element ones, over more
+     * elements than the tests above and with a stride that is not a multiple
+     * of 16. */
+    for (i = 0; i < ARRAY_SIZE(in); ++i)
+    {
+        in[i].v.x = i * 0.75f - 9.0f;
+        in[i].v.y = 3.0f - i * 0.5f;
+        in[i].v.z = i * 1.25f + 0.5f;
+        in[i].v.w = 1.0f + (i % 3) * 0.5f;
+        in[i].pad = -1.0f;
+        vec3[i] = *(D3DXVECTOR3 *)&in[i].v;
+    }
+
+    set_matrix(&mat,
+            0.5f, 2.0f, -3.0f, 0.25f,
+            5.0f, -6.0f, 7.0f, 0.5f,
+            9.0f, 1.0f, -1.5f, 0.75f,
+            -3.0f, 4.0f, 15.0f, 2.0f);
+    D3DXMatrixPerspectiveFovLH(&projection, D3DX_PI / 3.0f, 4.0f / 3.0f, 0.5f, 500.0f);
+    D3DXMatrixLookAtLH(&view, &vec3[1], &vec3[30], &vec3[7]);
+    D3DXMatrixRotationYawPitchRoll(&world, 0.3f, -0.7f, 1.1f);
+
+    memset(out, 0, sizeof(out));
+    D3DXVec3TransformArray(&out[0].v, sizeof(*out), &in[0].v, sizeof(*in), &mat, ARRAY_SIZE(in));
+    for (i = 0; i < ARRAY_SIZE(in); ++i)
+    {
+        D3DXVec3Transform(&exp4, &vec3[i], &mat);
+        expect_vec4(&exp4, &out[i].v, 1);
+        ok(out[i].pad == 0.0f, "Got unexpected pad %.8e at index %u.\n", out[i].pad, i);
+    }
+
+    memset(out, 0, sizeof(out));
+    D3DXVec4TransformArray(&out[0].v, sizeof(*out), &in[0].v, sizeof(*in), &mat, ARRAY_SIZE(in));
+    for (i = 0; i < ARRAY_SIZE(in); ++i)
+    {
+        D3DXVec4Transform(&exp4, &in[i].v, &mat);
+        expect_vec4(&exp4, &out[i].v, 1);
+        ok(out[i].pad == 0.0f, "Got unexpected pad %.8e at index %u.\n", out[i].pad, i);
+    }
+
+    memset(out, 0, sizeof(out));
+    D3DXVec3TransformCoordArray((D3DXVECTOR3 *)&out[0].v, sizeof(*out), (D3DXVECTOR3 *)&in[0].v,
+            sizeof(*in), &mat, ARRAY_SIZE(in));
+    for (i = 0; i < ARRAY_SIZE(in); ++i)
+    {
+        D3DXVec3TransformCoord(&exp3, &vec3[i], &mat);
+        expect_vec3(&exp3, (D3DXVECTOR3 *)&out[i].v, 1);
+        ok(out[i].v.w == 0.0f, "Got unexpected w %.8e at index %u.\n", out[i].v.w, i);
+    }
+
+    memset(out, 0, sizeof(out));
+    D3DXVec3ProjectArray((D3DXVECTOR3 *)&out[0].v, sizeof(*out), (D3DXVECTOR3 *)&in[0].v,
+            sizeof(*in), &viewport, &projection, &view, &world, ARRAY_SIZE(in));
+    for (i = 0; i < ARRAY_SIZE(in); ++i)
+    {
+        D3DXVec3Project(&exp3, &vec3[i], &viewport, &projection, &view, &world);
+        expect_vec3(&exp3, (D3DXVECTOR3 *)&out[i].v, 4);
+    }
+
+    memset(out, 0, sizeof(out));
+    D3DXVec3UnprojectArray((D3DXVECTOR3 *)&out[0].v, sizeof(*out), (D3DXVECTOR3 *)&in[0].v,
+            sizeof(*in), &viewport, &projection, &view, &world, ARRAY_SIZE(in));
+    for (i = 0; i < ARRAY_SIZE(in); ++i)
+    {
+        D3DXVec3Unproject(&exp3, &vec3[i], &viewport, &projection, &view, &world);
+        expect_vec3(&exp3, (D3DXVECTOR3 *)&out[i].v, 4);
+    }
+
+    /* In place. */
+    D3DXVec3TransformCoordArray(vec3, sizeof(*vec3), vec3, sizeof(*vec3), &mat, ARRAY_SIZE(vec3));
+    for (i = 0; i < ARRAY_SIZE(vec3); ++i)
+    {
+        D3DXVec3TransformCoord(&exp3, (D3DXVECTOR3 *)&in[i].v, &mat);
+        expect_vec3(&exp3, &vec3[i], 1);
+    }
+}
+
 static void test_D3DXFloat_Array(void)
 {
     unsigned int i;
@@ -4587,6 +4681,7 @@ START_TEST(math)
     test_Matrix_Decompose();
     test_Matrix_Transformation2D();
     test_D3DXVec_Array();
+    test_D3DXVec_Array_elements();
     test_D3DXFloat_Array();
     test_D3DXSHAdd();
     test_D3DXSHDot();
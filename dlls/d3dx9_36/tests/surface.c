@@ -1524,6 +1524,87 @@ static void test_D3DXLoadSurface(IDirect3DDevice9 *device)
     if(testbitmap_ok) DeleteFileA("testbitmap.bmp");
 }
 
+static void test_D3DXLoadSurface_dxtn(IDirect3DDevice9 *device)
+{
+    static const BYTE dxt1_block[] =
+    {
+        /* White and black, 4 color mode. */
+        0xff, 0xff, 0x00, 0x00, 0xe4, 0x1b, 0x00, 0xff,
+    };
+    static const BYTE dxt1_alpha_block[] =
+    {
+        /* Black and red, 3 color mode with transparent black. */
+        0x00, 0x00, 0x00, 0x10, 0xe4, 0x00, 0x00, 0x00,
+    };
+    static const BYTE dxt3_block[] =
+    {
+        0xf0, 0x38, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        /* Red and blue. */
+        0x00, 0xf8, 0x1f, 0x00, 0x00, 0x55, 0xaa, 0xff,
+    };
+    static const BYTE dxt5_block[] =
+    {
+        /* Alphas 140 and 0, 8 alpha mode. */
+        0x8c, 0x00, 0x88, 0x0e, 0x00, 0x00, 0x00, 0x00,
+        /* Green. */
+        0xe0, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    static const struct
+    {
+        const BYTE *block;
+        D3DFORMAT format;
+        unsigned int pitch;
+        DWORD expected[16];
+    }
+    tests[] =
+    {
+        {dxt1_block, D3DFMT_DXT1, 8,
+                {0xffffffff, 0xff000000, 0xffaaaaaa, 0xff555555, 0xff555555, 0xffaaaaaa, 0xff000000, 0xffffffff,
+                 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xff555555, 0xff555555, 0xff555555, 0xff555555}},
+        {dxt1_alpha_block, D3DFMT_DXT1, 8,
+                {0xff000000, 0xff100000, 0xff080000, 0x00000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000,
+                 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000}},
+        {dxt3_block, D3DFMT_DXT3, 16,
+                {0x00ff0000, 0xffff0000, 0x88ff0000, 0x33ff0000, 0xff0000ff, 0xff0000ff, 0xff0000ff, 0xff0000ff,
+                 0xffaa0055, 0xffaa0055, 0xffaa0055, 0xffaa0055, 0xff5500aa, 0xff5500aa, 0xff5500aa, 0xff5500aa}},
+        {dxt5_block, D3DFMT_DXT5, 16,
+                {0x8c00ff00, 0x0000ff00, 0x7800ff00, 0x1400ff00, 0x8c00ff00, 0x8c00ff00, 0x8c00ff00, 0x8c00ff00,
+                 0x8c00ff00, 0x8c00ff00, 0x8c00ff00, 0x8c00ff00, 0x8c00ff00, 0x8c00ff00, 0x8c00ff00, 0x8c00ff00}},
+    };
+    D3DLOCKED_RECT lockrect;
+    IDirect3DSurface9 *surf;
+    unsigned int i, x, y;
+    RECT rect;
+    HRESULT hr;
+
+    hr = IDirect3DDevice9_CreateOffscreenPlainSurface(device, 4, 4, D3DFMT_A8R8G8B8, D3DPOOL_SYSTEMMEM, &surf, NULL);
+    if (FAILED(hr))
+    {
+        skip("Failed to create A8R8G8B8 surface, hr %#x.\n", hr);
+        return;
+    }
+
+    SetRect(&rect, 0, 0, 4, 4);
+    for (i = 0; i < ARRAY_SIZE(tests); ++i)
+    {
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, tests[i].block, tests[i].format, tests[i].pitch,
+                NULL, &rect, D3DX_FILTER_NONE, 0);
+        ok(hr == D3D_OK, "Test %u: got unexpected hr %#x.\n", i, hr);
+
+        hr = IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        ok(hr == D3D_OK, "Test %u: failed to lock surface, hr %#x.\n", i, hr);
+        for (y = 0; y < 4; ++y)
+        {
+            for (x = 0; x < 4; ++x)
+                check_pixel_4bpp(&lockrect, x, y, tests[i].expected[y * 4 + x]);
+        }
+        hr = IDirect3DSurface9_UnlockRect(surf);
+        ok(hr == D3D_OK, "Test %u: failed to unlock surface, hr %#x.\n", i, hr);
+    }
+
+    check_release((IUnknown *)surf, 0);
+}
+
 static void test_D3DXSaveSurfaceToFileInMemory(IDirect3DDevice9 *device)
 {
     static const struct
@@ -1787,6 +1868,7 @@ START_TEST(surface)
 
     test_D3DXGetImageInfo();
     test_D3DXLoadSurface(device);
+    test_D3DXLoadSurface_dxtn(device);
     test_D3DXSaveSurfaceToFileInMemory(device);
     test_D3DXSaveSurfaceToFile(device);
 
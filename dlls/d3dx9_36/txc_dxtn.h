@@ -45,6 +45,13 @@ void fetch_2d_texel_rgba_dxt3(GLint srcRowStride, const GLubyte *pixdata,
 void fetch_2d_texel_rgba_dxt5(GLint srcRowStride, const GLubyte *pixdata,
 			     GLint i, GLint j, GLvoid *texel);
 
+void fetch_2d_block_rgba_dxt1(GLint srcRowStride, const GLubyte *pixdata,
+			     GLint i, GLint j, GLvoid *texels);
+void fetch_2d_block_rgba_dxt3(GLint srcRowStride, const GLubyte *pixdata,
+			     GLint i, GLint j, GLvoid *texels);
+void fetch_2d_block_rgba_dxt5(GLint srcRowStride, const GLubyte *pixdata,
+			     GLint i, GLint j, GLvoid *texels);
+
 void tx_compress_dxtn(GLint srccomps, GLint width, GLint height,
 		      const GLubyte *srcPixData, GLenum destformat,
 		      GLubyte *dest, GLint dstRowStride);
@@ -241,3 +241,108 @@ void fetch_2d_texel_rgba_dxt5(GLint srcRowStride, const GLubyte *pixdata,
       rgba[ACOMP] = CHAN_MAX;
 #endif
 }
+
+/* Decoding a whole block at once, computing the palettes only once. These
+ * give the same texels as the fetch functions above. */
+
+static void dxt135_decode_block ( const GLubyte *img_block_src,
+                         GLuint dxt_type, GLchan texels[16][4] ) {
+   const GLushort color0 = img_block_src[0] | (img_block_src[1] << 8);
+   const GLushort color1 = img_block_src[2] | (img_block_src[3] << 8);
+   const GLuint bits = img_block_src[4] | (img_block_src[5] << 8) |
+      (img_block_src[6] << 16) | (img_block_src[7] << 24);
+   GLchan palette[4][4];
+   GLuint k, code;
+
+   palette[0][RCOMP] = UBYTE_TO_CHAN( EXP5TO8R(color0) );
+   palette[0][GCOMP] = UBYTE_TO_CHAN( EXP6TO8G(color0) );
+   palette[0][BCOMP] = UBYTE_TO_CHAN( EXP5TO8B(color0) );
+   palette[1][RCOMP] = UBYTE_TO_CHAN( EXP5TO8R(color1) );
+   palette[1][GCOMP] = UBYTE_TO_CHAN( EXP6TO8G(color1) );
+   palette[1][BCOMP] = UBYTE_TO_CHAN( EXP5TO8B(color1) );
+   palette[0][ACOMP] = palette[1][ACOMP] = palette[2][ACOMP] = palette[3][ACOMP] = CHAN_MAX;
+   if ((dxt_type > 1) || (color0 > color1)) {
+      palette[2][RCOMP] = UBYTE_TO_CHAN( ((EXP5TO8R(color0) * 2 + EXP5TO8R(color1)) / 3) );
+      palette[2][GCOMP] = UBYTE_TO_CHAN( ((EXP6TO8G(color0) * 2 + EXP6TO8G(color1)) / 3) );
+      palette[2][BCOMP] = UBYTE_TO_CHAN( ((EXP5TO8B(color0) * 2 + EXP5TO8B(color1)) / 3) );
+      palette[3][RCOMP] = UBYTE_TO_CHAN( ((EXP5TO8R(color0) + EXP5TO8R(color1) * 2) / 3) );
+      palette[3][GCOMP] = UBYTE_TO_CHAN( ((EXP6TO8G(color0) + EXP6TO8G(color1) * 2) / 3) );
+      palette[3][BCOMP] = UBYTE_TO_CHAN( ((EXP5TO8B(color0) + EXP5TO8B(color1) * 2) / 3) );
+   }
+   else {
+      palette[2][RCOMP] = UBYTE_TO_CHAN( ((EXP5TO8R(color0) + EXP5TO8R(color1)) / 2) );
+      palette[2][GCOMP] = UBYTE_TO_CHAN( ((EXP6TO8G(color0) + EXP6TO8G(color1)) / 2) );
+      palette[2][BCOMP] = UBYTE_TO_CHAN( ((EXP5TO8B(color0) + EXP5TO8B(color1)) / 2) );
+      palette[3][RCOMP] = 0;
+      palette[3][GCOMP] = 0;
+      palette[3][BCOMP] = 0;
+      if (dxt_type == 1) palette[3][ACOMP] = UBYTE_TO_CHAN(0);
+   }
+
+   for (k = 0; k < 16; k++) {
+      code = (bits >> (2 * k)) & 3;
+      texels[k][RCOMP] = palette[code][RCOMP];
+      texels[k][GCOMP] = palette[code][GCOMP];
+      texels[k][BCOMP] = palette[code][BCOMP];
+      texels[k][ACOMP] = palette[code][ACOMP];
+   }
+}
+
+void fetch_2d_block_rgba_dxt1(GLint srcRowStride, const GLubyte *pixdata,
+                         GLint i, GLint j, GLvoid *texels)
+{
+   /* Extract the 4x4 block containing the (i,j) pixel from pixdata and
+    * return it in texels[16][4], row by row.
+    */
+
+   const GLubyte *blksrc = (pixdata + ((srcRowStride + 3) / 4 * (j / 4) + (i / 4)) * 8);
+   dxt135_decode_block(blksrc, 1, texels);
+}
+
+void fetch_2d_block_rgba_dxt3(GLint srcRowStride, const GLubyte *pixdata,
+                         GLint i, GLint j, GLvoid *texels)
+{
+   GLchan (*rgba)[4] = texels;
+   const GLubyte *blksrc = (pixdata + ((srcRowStride + 3) / 4 * (j / 4) + (i / 4)) * 16);
+   GLuint k;
+
+   dxt135_decode_block(blksrc + 8, 2, rgba);
+   for (k = 0; k < 16; k++) {
+      const GLubyte anibble = (blksrc[k / 2] >> (4 * (k & 1))) & 0xf;
+      rgba[k][ACOMP] = UBYTE_TO_CHAN( (GLubyte)(EXP4TO8(anibble)) );
+   }
+}
+
+void fetch_2d_block_rgba_dxt5(GLint srcRowStride, const GLubyte *pixdata,
+                         GLint i, GLint j, GLvoid *texels)
+{
+   GLchan (*rgba)[4] = texels;
+   const GLubyte *blksrc = (pixdata + ((srcRowStride + 3) / 4 * (j / 4) + (i / 4)) * 16);
+   const GLubyte alpha0 = blksrc[0];
+   const GLubyte alpha1 = blksrc[1];
+   GLchan alphas[8];
+   GLuint k, code;
+
+   alphas[0] = UBYTE_TO_CHAN( alpha0 );
+   alphas[1] = UBYTE_TO_CHAN( alpha1 );
+   for (code = 2; code < 8; code++) {
+      if (alpha0 > alpha1)
+         alphas[code] = UBYTE_TO_CHAN( ((alpha0 * (8 - code) + (alpha1 * (code - 1))) / 7) );
+      else if (code < 6)
+         alphas[code] = UBYTE_TO_CHAN( ((alpha0 * (6 - code) + (alpha1 * (code - 1))) / 5) );
+      else if (code == 6)
+         alphas[code] = 0;
+      else
+         alphas[code] = CHAN_MAX;
+   }
+
+   dxt135_decode_block(blksrc + 8, 2, rgba);
+   for (k = 0; k < 16; k++) {
+      const GLuint bit_pos = k * 3;
+      const GLubyte acodelow = blksrc[2 + bit_pos / 8];
+      const GLubyte acodehigh = blksrc[3 + bit_pos / 8];
+      code = (acodelow >> (bit_pos & 0x7) |
+         (acodehigh  << (8 - (bit_pos & 0x7)))) & 0x7;
+      rgba[k][ACOMP] = alphas[code];
+   }
+}
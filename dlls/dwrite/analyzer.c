@@ -22,6 +22,9 @@
 #define COBJMACROS
 
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "dwrite_private.h"
 #include "scripts.h"
@@ -298,17 +301,46 @@ static DWRITE_SCRIPT_ANALYSIS get_char_sa(WCHAR c)
     DWRITE_SCRIPT_ANALYSIS sa;
     WORD type;
 
-    GetStringTypeW(CT_CTYPE1, &c, 1, &type);
     sa.script = get_char_script(c);
+    if (c < 0x80)
+    {
+        sa.shapes = c < 0x20 || c == 0x7f ? DWRITE_SCRIPT_SHAPES_NO_VISUAL : DWRITE_SCRIPT_SHAPES_DEFAULT;
+        return sa;
+    }
+
+    GetStringTypeW(CT_CTYPE1, &c, 1, &type);
     sa.shapes = (type & C1_CNTRL) || c == 0x2028 /* LINE SEPARATOR */ || c == 0x2029 /* PARAGRAPH SEPARATOR */ ?
         DWRITE_SCRIPT_SHAPES_NO_VISUAL : DWRITE_SCRIPT_SHAPES_DEFAULT;
     return sa;
 }
 
+/* Returns the number of printable ASCII characters at the start of the text. */
+static UINT32 get_printable_ascii_length(const WCHAR *text, UINT32 length)
+{
+    UINT32 i = 0;
+
+#ifdef __SSE2__
+    const __m128i lo = _mm_set1_epi16(0x1f), hi = _mm_set1_epi16(0x7f);
+
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&text[i]);
+
+        if (_mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi16(v, lo), _mm_cmplt_epi16(v, hi))) != 0xffff)
+            break;
+    }
+#endif
+
+    while (i < length && text[i] >= 0x20 && text[i] < 0x7f)
+        ++i;
+
+    return i;
+}
+
 static HRESULT analyze_script(const WCHAR *text, UINT32 position, UINT32 length, IDWriteTextAnalysisSink *sink)
 {
     DWRITE_SCRIPT_ANALYSIS sa;
-    UINT32 pos, i, seq_length;
+    UINT32 pos, i, seq_length, count;
 
     if (!length)
         return S_OK;
@@ -320,7 +352,19 @@ static HRESULT analyze_script(const WCHAR *text, UINT32 position, UINT32 length,
 
     for (i = 1; i < length; i++)
     {
-        DWRITE_SCRIPT_ANALYSIS cur_sa = get_char_sa(text[i]);
+        DWRITE_SCRIPT_ANALYSIS cur_sa;
+
+        /* Printable ASCII characters are either Latin or common characters with default shapes,
+           both extend a Latin sequence. */
+        if (sa.script == Script_Latin && sa.shapes == DWRITE_SCRIPT_SHAPES_DEFAULT)
+        {
+            count = get_printable_ascii_length(&text[i], length - i);
+            seq_length += count;
+            if ((i += count) == length)
+                break;
+        }
+
+        cur_sa = get_char_sa(text[i]);
 
         /* Unknown type is ignored when preceded or followed by another script */
         switch (sa.script) {
@@ -450,12 +494,61 @@ BOOL lb_is_newline_char(WCHAR ch)
     return c == b_LF || c == b_NL || c == b_CR || c == b_BK;
 }
 
+/* Text made of letters, digits, spaces and a few punctuation characters only needs a subset
+   of the rules: breaks are only allowed after spaces, exclamation and question marks, and hyphens,
+   and never before spaces or punctuation, apart from a hyphen following a space. */
+static BOOL analyze_simple_linebreaks(const WCHAR *text, UINT32 count, DWRITE_LINE_BREAKPOINT *breakpoints)
+{
+    short prev = 0, cur;
+    UINT32 i;
+
+    if (!count || get_printable_ascii_length(text, count) != count)
+        return FALSE;
+
+    for (i = 0; i < count; ++i)
+    {
+        if ((text[i] >= 'a' && text[i] <= 'z') || (text[i] >= 'A' && text[i] <= 'Z'))
+            cur = b_AL;
+        else if (text[i] >= '0' && text[i] <= '9')
+            cur = b_NU;
+        else if (text[i] == ' ')
+            cur = b_SP;
+        else if (text[i] == ',' || text[i] == '.' || text[i] == ':' || text[i] == ';')
+            cur = b_IS;
+        else if (text[i] == '!' || text[i] == '?')
+            cur = b_EX;
+        else if (text[i] == '-')
+            cur = b_HY;
+        else
+            return FALSE;
+
+        if ((prev == b_SP && (cur == b_AL || cur == b_NU || cur == b_HY))
+                || (prev == b_EX && (cur == b_AL || cur == b_NU))
+                || (prev == b_HY && cur == b_AL))
+            breakpoints[i].breakConditionBefore = DWRITE_BREAK_CONDITION_CAN_BREAK;
+        else
+            breakpoints[i].breakConditionBefore = DWRITE_BREAK_CONDITION_MAY_NOT_BREAK;
+        if (i)
+            breakpoints[i - 1].breakConditionAfter = breakpoints[i].breakConditionBefore;
+        breakpoints[i].isWhitespace = cur == b_SP;
+        breakpoints[i].isSoftHyphen = 0;
+        breakpoints[i].padding = 0;
+        prev = cur;
+    }
+    breakpoints[count - 1].breakConditionAfter = DWRITE_BREAK_CONDITION_CAN_BREAK;
+
+    return TRUE;
+}
+
 static HRESULT analyze_linebreaks(const WCHAR *text, UINT32 count, DWRITE_LINE_BREAKPOINT *breakpoints)
 {
     struct linebreaking_state state;
     short *break_class;
     int i, j;
 
+    if (analyze_simple_linebreaks(text, count, breakpoints))
+        return S_OK;
+
     if (!(break_class = calloc(count, sizeof(*break_class))))
         return E_OUTOFMEMORY;
 
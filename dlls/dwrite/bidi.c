@@ -42,6 +42,9 @@
  */
 
 #include <stdarg.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "windef.h"
 #include "winbase.h"
@@ -1046,6 +1049,33 @@ search:
     return hr;
 }
 
+/* Characters below U+0590 are never R, AL, AN or explicit formatting characters. In a
+   left-to-right paragraph, text made only of them resolves to the paragraph level. */
+static BOOL bidi_is_simple_ltr(const WCHAR *string, UINT32 count)
+{
+    UINT32 i = 0;
+
+#ifdef __SSE2__
+    const __m128i max = _mm_set1_epi16(0x058f), zero = _mm_setzero_si128();
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_subs_epu16(_mm_loadu_si128((const __m128i *)&string[i]), max);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(v, zero)) != 0xffff)
+            return FALSE;
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        if (string[i] >= 0x0590)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
 HRESULT bidi_computelevels(const WCHAR *string, UINT32 count, UINT8 baselevel, UINT8 *explicit, UINT8 *levels)
 {
     IsolatedRun *iso_run, *next;
@@ -1055,6 +1085,13 @@ HRESULT bidi_computelevels(const WCHAR *string, UINT32 count, UINT8 baselevel, U
 
     TRACE("%s, %u\n", debugstr_wn(string, count), count);
 
+    if (!baselevel && bidi_is_simple_ltr(string, count))
+    {
+        memset(explicit, 0, count * sizeof(*explicit));
+        memset(levels, 0, count * sizeof(*levels));
+        return S_OK;
+    }
+
     if (!(chartype = malloc(count * sizeof(*chartype))))
         return E_OUTOFMEMORY;
 
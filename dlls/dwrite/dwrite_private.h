@@ -341,6 +341,25 @@ extern HRESULT create_gdiinterop(IDWriteFactory7 *factory, IDWriteGdiInterop1 **
 extern void fontface_detach_from_cache(IDWriteFontFace5 *fontface) DECLSPEC_HIDDEN;
 extern void factory_lock(IDWriteFactory7 *factory) DECLSPEC_HIDDEN;
 extern void factory_unlock(IDWriteFactory7 *factory) DECLSPEC_HIDDEN;
+
+/* Shaping output of a layout run, before character spacing is applied. */
+struct shaping_result
+{
+    IDWriteFontFace *fontface;
+    unsigned int length;
+    unsigned int glyph_count;
+    UINT16 *glyphs;
+    UINT16 *clustermap;
+    DWRITE_SHAPING_GLYPH_PROPERTIES *glyph_props;
+    float *advances;
+    DWRITE_GLYPH_OFFSET *offsets;
+};
+
+extern BOOL factory_get_shaping_result(IDWriteFactory7 *factory, const void *key, unsigned int key_size,
+        struct shaping_result *result) DECLSPEC_HIDDEN;
+extern void factory_cache_shaping_result(IDWriteFactory7 *factory, const void *key, unsigned int key_size,
+        const struct shaping_result *result) DECLSPEC_HIDDEN;
+extern void factory_detach_shaping_results(IDWriteFactory7 *factory, IDWriteFontFace *fontface) DECLSPEC_HIDDEN;
 extern HRESULT create_inmemory_fileloader(IDWriteInMemoryFontFileLoader **loader) DECLSPEC_HIDDEN;
 extern HRESULT create_font_resource(IDWriteFactory7 *factory, IDWriteFontFile *file, UINT32 face_index,
         IDWriteFontResource **resource) DECLSPEC_HIDDEN;
@@ -841,6 +841,7 @@ static ULONG WINAPI dwritefontface_Release(IDWriteFontFace5 *iface)
             factory_unlock(fontface->factory);
             free(fontface->cached);
         }
+        factory_detach_shaping_results(fontface->factory, (IDWriteFontFace *)iface);
         release_scriptshaping_cache(fontface->shaping_cache);
         if (fontface->vdmx.context)
             IDWriteFontFace5_ReleaseFontTable(iface, fontface->vdmx.context);
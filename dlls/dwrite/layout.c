@@ -895,7 +895,6 @@ static HRESULT layout_shape_get_glyphs(struct dwrite_textlayout *layout, struct
     unsigned int max_count;
     HRESULT hr;
 
-    run->descr.localeName = get_layout_range_by_pos(layout, run->descr.textPosition)->locale;
     run->clustermap = calloc(run->descr.stringLength, sizeof(*run->clustermap));
     if (!run->clustermap)
         return E_OUTOFMEMORY;
@@ -910,9 +909,6 @@ static HRESULT layout_shape_get_glyphs(struct dwrite_textlayout *layout, struct
     if (!context->text_props || !context->glyph_props)
         return E_OUTOFMEMORY;
 
-    if (FAILED(hr = layout_shape_get_user_features(layout, context)))
-        return hr;
-
     for (;;)
     {
         hr = IDWriteTextAnalyzer2_GetGlyphs(context->analyzer, run->descr.string, run->descr.stringLength, run->run.fontFace,
@@ -1059,26 +1055,163 @@ static HRESULT layout_shape_get_positions(struct dwrite_textlayout *layout, stru
         WARN("%s: failed to get glyph placement info, hr %#lx.\n", debugstr_rundescr(&run->descr), hr);
     }
 
-    if (SUCCEEDED(hr))
-        hr = layout_shape_apply_character_spacing(layout, context);
-
     run->run.glyphAdvances = run->advances;
     run->run.glyphOffsets = run->offsets;
 
     return hr;
 }
 
+struct shaping_cache_key_header
+{
+    IDWriteFontFace *fontface;
+    float emsize;
+    float ppdip;
+    DWRITE_MATRIX transform;
+    DWRITE_SCRIPT_ANALYSIS sa;
+    unsigned int flags;
+    unsigned int length;
+    unsigned int locale_length;
+    unsigned int range_count;
+    /* WCHAR string[length]; */
+    /* WCHAR locale[locale_length]; */
+    /* per feature range: length, feature count, features */
+};
+
+#define SHAPING_KEY_SIDEWAYS     0x1
+#define SHAPING_KEY_RTL          0x2
+#define SHAPING_KEY_GDI          0x4
+#define SHAPING_KEY_GDI_NATURAL  0x8
+
+/* Shaping results are cached by the factory, keyed on everything that is passed to the
+   analyzer. Character spacing is specific to the layout and is applied afterwards. */
+static void *layout_shape_get_cache_key(struct dwrite_textlayout *layout, struct shaping_context *context,
+        unsigned int *size)
+{
+    struct regular_layout_run *run = context->run;
+    struct shaping_cache_key_header *header;
+    unsigned int i, locale_length;
+    BYTE *key;
+
+    if (!run->run.fontFace || unsafe_impl_from_IDWriteFontFace(run->run.fontFace)->factory != layout->factory)
+        return NULL;
+
+    locale_length = wcslen(run->descr.localeName) + 1;
+    *size = sizeof(*header) + (run->descr.stringLength + locale_length) * sizeof(WCHAR);
+    for (i = 0; i < context->user_features.range_count; ++i)
+        *size += 2 * sizeof(UINT32) + context->user_features.features[i]->featureCount * sizeof(DWRITE_FONT_FEATURE);
+    *size = (*size + sizeof(UINT32) - 1) & ~(sizeof(UINT32) - 1);
+
+    if (!(key = calloc(1, *size)))
+        return NULL;
+
+    header = (struct shaping_cache_key_header *)key;
+    header->fontface = run->run.fontFace;
+    header->emsize = run->run.fontEmSize;
+    /* Field by field, so that padding stays zeroed for comparisons. */
+    header->sa.script = run->sa.script;
+    header->sa.shapes = run->sa.shapes;
+    if (run->run.isSideways) header->flags |= SHAPING_KEY_SIDEWAYS;
+    if (run->run.bidiLevel & 1) header->flags |= SHAPING_KEY_RTL;
+    if (is_layout_gdi_compatible(layout))
+    {
+        header->flags |= SHAPING_KEY_GDI;
+        if (layout->measuringmode == DWRITE_MEASURING_MODE_GDI_NATURAL) header->flags |= SHAPING_KEY_GDI_NATURAL;
+        header->ppdip = layout->ppdip;
+        header->transform = layout->transform;
+    }
+    header->length = run->descr.stringLength;
+    header->locale_length = locale_length;
+    header->range_count = context->user_features.range_count;
+
+    key += sizeof(*header);
+    memcpy(key, run->descr.string, run->descr.stringLength * sizeof(WCHAR));
+    key += run->descr.stringLength * sizeof(WCHAR);
+    memcpy(key, run->descr.localeName, locale_length * sizeof(WCHAR));
+    key += locale_length * sizeof(WCHAR);
+
+    for (i = 0; i < context->user_features.range_count; ++i)
+    {
+        const DWRITE_TYPOGRAPHIC_FEATURES *features = context->user_features.features[i];
+        UINT32 range[2] = { context->user_features.range_lengths[i], features->featureCount };
+
+        memcpy(key, range, sizeof(range));
+        key += sizeof(range);
+        memcpy(key, features->features, features->featureCount * sizeof(*features->features));
+        key += features->featureCount * sizeof(*features->features);
+    }
+
+    return header;
+}
+
+static BOOL layout_shape_get_cached_result(struct dwrite_textlayout *layout, struct shaping_context *context,
+        const void *key, unsigned int size)
+{
+    struct regular_layout_run *run = context->run;
+    struct shaping_result result;
+
+    if (!factory_get_shaping_result(layout->factory, key, size, &result))
+        return FALSE;
+
+    run->glyphs = result.glyphs;
+    run->clustermap = result.clustermap;
+    run->advances = result.advances;
+    run->offsets = result.offsets;
+    run->glyphcount = result.glyph_count;
+    context->glyph_props = result.glyph_props;
+
+    run->run.glyphIndices = run->glyphs;
+    run->descr.clusterMap = run->clustermap;
+    run->run.glyphAdvances = run->advances;
+    run->run.glyphOffsets = run->offsets;
+
+    return TRUE;
+}
+
+static void layout_shape_cache_result(struct dwrite_textlayout *layout, struct shaping_context *context,
+        const void *key, unsigned int size)
+{
+    struct regular_layout_run *run = context->run;
+    struct shaping_result result;
+
+    result.fontface = run->run.fontFace;
+    result.length = run->descr.stringLength;
+    result.glyph_count = run->glyphcount;
+    result.glyphs = run->glyphs;
+    result.clustermap = run->clustermap;
+    result.glyph_props = context->glyph_props;
+    result.advances = run->advances;
+    result.offsets = run->offsets;
+
+    factory_cache_shaping_result(layout->factory, key, size, &result);
+}
+
 static HRESULT layout_shape_run(struct dwrite_textlayout *layout, struct regular_layout_run *run)
 {
     struct shaping_context context = { 0 };
+    unsigned int key_size = 0;
+    void *key = NULL;
     HRESULT hr;
 
     context.analyzer = get_text_analyzer();
     context.run = run;
 
-    if (SUCCEEDED(hr = layout_shape_get_glyphs(layout, &context)))
-        hr = layout_shape_get_positions(layout, &context);
+    run->descr.localeName = get_layout_range_by_pos(layout, run->descr.textPosition)->locale;
+
+    if (SUCCEEDED(hr = layout_shape_get_user_features(layout, &context)))
+    {
+        key = layout_shape_get_cache_key(layout, &context, &key_size);
+        if (!key || !layout_shape_get_cached_result(layout, &context, key, key_size))
+        {
+            if (SUCCEEDED(hr = layout_shape_get_glyphs(layout, &context)) &&
+                    SUCCEEDED(hr = layout_shape_get_positions(layout, &context)) && key)
+                layout_shape_cache_result(layout, &context, key, key_size);
+        }
+
+        if (SUCCEEDED(hr))
+            hr = layout_shape_apply_character_spacing(layout, &context);
+    }
 
+    free(key);
     layout_shape_clear_context(&context);
 
     /* Special treatment for runs that don't produce visual output, shaping code adds normal glyphs for them,
@@ -609,6 +609,17 @@ struct dwritefactory
     struct list collection_loaders;
     struct list file_loaders;
 
+    struct
+    {
+        struct wine_rb_tree tree;
+        struct list mru;
+        size_t max_size;
+        size_t size;
+        unsigned int hits;
+        unsigned int misses;
+        unsigned int evictions;
+    } shaping_cache;
+
     CRITICAL_SECTION cs;
 };
 
@@ -636,6 +647,209 @@ static void release_fileloader(struct fileloader *fileloader)
     free(fileloader);
 }
 
+struct shaping_cache_key
+{
+    unsigned int hash;
+    unsigned int size;
+    const void *data;
+};
+
+struct shaping_cache_entry
+{
+    struct wine_rb_entry entry;
+    struct list mru;
+    IDWriteFontFace *fontface;
+    size_t size;
+    unsigned int hash;
+    unsigned int key_size;
+    unsigned int length;
+    unsigned int glyph_count;
+    float *advances;
+    DWRITE_GLYPH_OFFSET *offsets;
+    UINT16 *glyphs;
+    UINT16 *clustermap;
+    DWRITE_SHAPING_GLYPH_PROPERTIES *glyph_props;
+    BYTE *key;
+};
+
+static int shaping_cache_compare(const void *k, const struct wine_rb_entry *e)
+{
+    const struct shaping_cache_entry *entry = WINE_RB_ENTRY_VALUE(e, const struct shaping_cache_entry, entry);
+    const struct shaping_cache_key *key = k;
+
+    if (key->hash != entry->hash) return key->hash < entry->hash ? -1 : 1;
+    if (key->size != entry->key_size) return key->size < entry->key_size ? -1 : 1;
+    return memcmp(key->data, entry->key, key->size);
+}
+
+static void shaping_cache_init_key(struct shaping_cache_key *key, const void *data, unsigned int size)
+{
+    const BYTE *ptr = data;
+    unsigned int i;
+
+    key->hash = 0x811c9dc5;
+    for (i = 0; i < size; ++i)
+        key->hash = (key->hash ^ ptr[i]) * 0x01000193;
+    key->size = size;
+    key->data = data;
+}
+
+static void release_shaping_cache_entry(struct dwritefactory *factory, struct shaping_cache_entry *entry)
+{
+    wine_rb_remove(&factory->shaping_cache.tree, &entry->entry);
+    list_remove(&entry->mru);
+    factory->shaping_cache.size -= entry->size;
+    free(entry);
+}
+
+static void release_shaping_cache(struct dwritefactory *factory)
+{
+    struct shaping_cache_entry *entry, *entry2;
+
+    TRACE("%p: shaping cache %u hits, %u misses, %u evictions, %Iu bytes.\n", factory,
+            factory->shaping_cache.hits, factory->shaping_cache.misses, factory->shaping_cache.evictions,
+            factory->shaping_cache.size);
+
+    LIST_FOR_EACH_ENTRY_SAFE(entry, entry2, &factory->shaping_cache.mru, struct shaping_cache_entry, mru)
+        release_shaping_cache_entry(factory, entry);
+}
+
+BOOL factory_get_shaping_result(IDWriteFactory7 *iface, const void *data, unsigned int size,
+        struct shaping_result *result)
+{
+    struct dwritefactory *factory = impl_from_IDWriteFactory7(iface);
+    struct shaping_cache_entry *entry;
+    struct shaping_cache_key key;
+    struct wine_rb_entry *e;
+    BOOL ret = FALSE;
+
+    shaping_cache_init_key(&key, data, size);
+
+    EnterCriticalSection(&factory->cs);
+
+    if ((e = wine_rb_get(&factory->shaping_cache.tree, &key)))
+    {
+        entry = WINE_RB_ENTRY_VALUE(e, struct shaping_cache_entry, entry);
+
+        result->glyph_count = entry->glyph_count;
+        result->glyphs = malloc(entry->glyph_count * sizeof(*result->glyphs));
+        result->clustermap = malloc(entry->length * sizeof(*result->clustermap));
+        result->glyph_props = malloc(entry->glyph_count * sizeof(*result->glyph_props));
+        result->advances = malloc(entry->glyph_count * sizeof(*result->advances));
+        result->offsets = malloc(entry->glyph_count * sizeof(*result->offsets));
+
+        if (result->glyphs && result->clustermap && result->glyph_props && result->advances && result->offsets)
+        {
+            memcpy(result->glyphs, entry->glyphs, entry->glyph_count * sizeof(*result->glyphs));
+            memcpy(result->clustermap, entry->clustermap, entry->length * sizeof(*result->clustermap));
+            memcpy(result->glyph_props, entry->glyph_props, entry->glyph_count * sizeof(*result->glyph_props));
+            memcpy(result->advances, entry->advances, entry->glyph_count * sizeof(*result->advances));
+            memcpy(result->offsets, entry->offsets, entry->glyph_count * sizeof(*result->offsets));
+
+            list_remove(&entry->mru);
+            list_add_head(&factory->shaping_cache.mru, &entry->mru);
+            ret = TRUE;
+        }
+        else
+        {
+            free(result->glyphs);
+            free(result->clustermap);
+            free(result->glyph_props);
+            free(result->advances);
+            free(result->offsets);
+            memset(result, 0, sizeof(*result));
+        }
+    }
+
+    if (ret)
+        factory->shaping_cache.hits++;
+    else
+        factory->shaping_cache.misses++;
+
+    LeaveCriticalSection(&factory->cs);
+
+    return ret;
+}
+
+void factory_cache_shaping_result(IDWriteFactory7 *iface, const void *data, unsigned int size,
+        const struct shaping_result *result)
+{
+    struct dwritefactory *factory = impl_from_IDWriteFactory7(iface);
+    struct shaping_cache_entry *entry, *old_entry;
+    struct shaping_cache_key key;
+    unsigned int count = result->glyph_count;
+    size_t entry_size;
+
+    entry_size = sizeof(*entry) + count * (sizeof(*entry->advances) + sizeof(*entry->offsets)
+            + sizeof(*entry->glyphs) + sizeof(*entry->glyph_props))
+            + result->length * sizeof(*entry->clustermap) + size;
+
+    /* Long runs are unlikely to be repeated, don't let them flush the cache. */
+    if (entry_size > factory->shaping_cache.max_size / 16)
+        return;
+
+    if (!(entry = malloc(entry_size)))
+        return;
+
+    shaping_cache_init_key(&key, data, size);
+
+    entry->fontface = result->fontface;
+    entry->size = entry_size;
+    entry->hash = key.hash;
+    entry->key_size = size;
+    entry->length = result->length;
+    entry->glyph_count = count;
+    entry->advances = (float *)(entry + 1);
+    entry->offsets = (DWRITE_GLYPH_OFFSET *)(entry->advances + count);
+    entry->glyphs = (UINT16 *)(entry->offsets + count);
+    entry->clustermap = entry->glyphs + count;
+    entry->glyph_props = (DWRITE_SHAPING_GLYPH_PROPERTIES *)(entry->clustermap + result->length);
+    entry->key = (BYTE *)(entry->glyph_props + count);
+
+    memcpy(entry->advances, result->advances, count * sizeof(*entry->advances));
+    memcpy(entry->offsets, result->offsets, count * sizeof(*entry->offsets));
+    memcpy(entry->glyphs, result->glyphs, count * sizeof(*entry->glyphs));
+    memcpy(entry->clustermap, result->clustermap, result->length * sizeof(*entry->clustermap));
+    memcpy(entry->glyph_props, result->glyph_props, count * sizeof(*entry->glyph_props));
+    memcpy(entry->key, data, size);
+    key.data = entry->key;
+
+    EnterCriticalSection(&factory->cs);
+
+    if (wine_rb_put(&factory->shaping_cache.tree, &key, &entry->entry) == -1)
+    {
+        /* Same result was added concurrently. */
+        LeaveCriticalSection(&factory->cs);
+        free(entry);
+        return;
+    }
+    list_add_head(&factory->shaping_cache.mru, &entry->mru);
+    factory->shaping_cache.size += entry_size;
+
+    while (factory->shaping_cache.size > factory->shaping_cache.max_size)
+    {
+        old_entry = LIST_ENTRY(list_tail(&factory->shaping_cache.mru), struct shaping_cache_entry, mru);
+        release_shaping_cache_entry(factory, old_entry);
+        factory->shaping_cache.evictions++;
+    }
+
+    LeaveCriticalSection(&factory->cs);
+}
+
+void factory_detach_shaping_results(IDWriteFactory7 *iface, IDWriteFontFace *fontface)
+{
+    struct dwritefactory *factory = impl_from_IDWriteFactory7(iface);
+    struct shaping_cache_entry *entry, *entry2;
+
+    EnterCriticalSection(&factory->cs);
+    LIST_FOR_EACH_ENTRY_SAFE(entry, entry2, &factory->shaping_cache.mru, struct shaping_cache_entry, mru)
+    {
+        if (entry->fontface == fontface)
+            release_shaping_cache_entry(factory, entry);
+    }
+    LeaveCriticalSection(&factory->cs);
+}
+
 static void release_dwritefactory(struct dwritefactory *factory)
 {
     struct fileloader *fileloader, *fileloader2;
@@ -643,6 +857,7 @@ static void release_dwritefactory(struct dwritefactory *factory)
 
     EnterCriticalSection(&factory->cs);
     release_fontface_cache(&factory->localfontfaces);
+    release_shaping_cache(factory);
     LeaveCriticalSection(&factory->cs);
 
     LIST_FOR_EACH_ENTRY_SAFE(loader, loader2, &factory->collection_loaders, struct collectionloader, entry) {
@@ -2048,6 +2263,10 @@ static void init_dwritefactory(struct dwritefactory *factory, DWRITE_FACTORY_TYP
     list_init(&factory->file_loaders);
     list_init(&factory->localfontfaces);
 
+    wine_rb_init(&factory->shaping_cache.tree, shaping_cache_compare);
+    list_init(&factory->shaping_cache.mru);
+    factory->shaping_cache.max_size = 0x40000;
+
     InitializeCriticalSection(&factory->cs);
     factory->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": dwritefactory.lock");
 }
@@ -6567,6 +6567,81 @@ if (SUCCEEDED(hr))
     IDWriteFactory_Release(factory);
 }
 
+static void get_layout_cluster_widths(IDWriteFactory *factory, IDWriteTextFormat *format, float spacing,
+        float size, float *widths, unsigned int count)
+{
+    static const WCHAR *str = L"Hello world";
+    DWRITE_CLUSTER_METRICS metrics[16];
+    DWRITE_TEXT_RANGE range = { 0, ~0u };
+    IDWriteTextLayout1 *layout1;
+    IDWriteTextLayout *layout;
+    unsigned int i;
+    UINT32 ret;
+    HRESULT hr;
+
+    hr = IDWriteFactory_CreateTextLayout(factory, str, wcslen(str), format, 1000.0f, 1000.0f, &layout);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+
+    if (spacing != 0.0f)
+    {
+        hr = IDWriteTextLayout_QueryInterface(layout, &IID_IDWriteTextLayout1, (void **)&layout1);
+        ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+        hr = IDWriteTextLayout1_SetCharacterSpacing(layout1, spacing, spacing, 0.0f, range);
+        ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+        IDWriteTextLayout1_Release(layout1);
+    }
+    if (size != 0.0f)
+    {
+        hr = IDWriteTextLayout_SetFontSize(layout, size, range);
+        ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+    }
+
+    hr = IDWriteTextLayout_GetClusterMetrics(layout, metrics, ARRAY_SIZE(metrics), &ret);
+    ok(hr == S_OK, "Unexpected hr %#lx.\n", hr);
+    ok(ret == count, "Unexpected cluster count %u.\n", ret);
+    for (i = 0; i < count; ++i)
+        widths[i] = metrics[i].width;
+
+    IDWriteTextLayout_Release(layout);
+}
+
+static void test_layout_reuse(void)
+{
+    float widths[11], widths2[11];
+    IDWriteTextFormat *format;
+    IDWriteFactory *factory;
+    unsigned int i;
+    HRESULT hr;
+
+    factory = create_factory();
+
+    hr = IDWriteFactory_CreateTextFormat(factory, L"Tahoma", NULL, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
+            DWRITE_FONT_STRETCH_NORMAL, 12.0f, L"en-us", &format);
+    ok(hr == S_OK, "Failed to create text format, hr %#lx.\n", hr);
+
+    /* Layouts created for the same text produce the same results, whatever other layouts
+       using the same text did before. */
+    get_layout_cluster_widths(factory, format, 0.0f, 0.0f, widths, ARRAY_SIZE(widths));
+    get_layout_cluster_widths(factory, format, 0.0f, 0.0f, widths2, ARRAY_SIZE(widths2));
+    for (i = 0; i < ARRAY_SIZE(widths); ++i)
+        ok(widths2[i] == widths[i], "%u: got width %.2f, expected %.2f.\n", i, widths2[i], widths[i]);
+
+    get_layout_cluster_widths(factory, format, 2.0f, 0.0f, widths2, ARRAY_SIZE(widths2));
+    for (i = 0; i < ARRAY_SIZE(widths); ++i)
+        ok(fabsf(widths2[i] - widths[i] - 4.0f) < 0.01f, "%u: got width %.2f, expected %.2f.\n", i, widths2[i], widths[i] + 4.0f);
+
+    get_layout_cluster_widths(factory, format, 0.0f, 0.0f, widths2, ARRAY_SIZE(widths2));
+    for (i = 0; i < ARRAY_SIZE(widths); ++i)
+        ok(widths2[i] == widths[i], "%u: got width %.2f, expected %.2f.\n", i, widths2[i], widths[i]);
+
+    get_layout_cluster_widths(factory, format, 0.0f, 24.0f, widths2, ARRAY_SIZE(widths2));
+    for (i = 0; i < ARRAY_SIZE(widths); ++i)
+        ok(widths2[i] > widths[i], "%u: got width %.2f, was %.2f.\n", i, widths2[i], widths[i]);
+
+    IDWriteTextFormat_Release(format);
+    IDWriteFactory_Release(factory);
+}
+
 START_TEST(layout)
 {
     IDWriteFactory *factory;
@@ -6623,6 +6698,7 @@ START_TEST(layout)
     test_text_format_axes();
     test_layout_range_length();
     test_HitTestTextRange();
+    test_layout_reuse();
 
     IDWriteFactory_Release(factory);
 }
@@ -7743,6 +7743,57 @@ static void test_GetOutlineTextMetrics_subst(void)
     ReleaseDC(0, hdc);
 }
 
+static void test_font_directory(void)
+{
+    char ttf_name[MAX_PATH], font_path[MAX_PATH], cmdline[MAX_PATH + 32];
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char **argv;
+    BOOL ret;
+
+    /* Windows only loads the fonts listed in the registry */
+    if (strcmp(winetest_platform, "wine"))
+    {
+        skip("Fonts directory scanning is Wine specific.\n");
+        return;
+    }
+    if (is_truetype_font_installed("wine_test"))
+    {
+        skip("Font wine_test is already installed.\n");
+        return;
+    }
+
+    ret = write_ttf_file("wine_test.ttf", ttf_name);
+    ok(ret, "Failed to create test font file.\n");
+    GetWindowsDirectoryA(font_path, MAX_PATH);
+    strcat(font_path, "\\fonts\\wine_font_index_test.ttf");
+    ret = CopyFileA(ttf_name, font_path, TRUE);
+    DeleteFileA(ttf_name);
+    if (!ret)
+    {
+        skip("Failed to copy font file to the fonts directory, error %lu.\n", GetLastError());
+        return;
+    }
+
+    /* the new font is found by a new process, even though this one already
+     * created the index of the system fonts */
+    winetest_get_mainargs(&argv);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    sprintf(cmdline, "%s font FontDirectory", argv[0]);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info);
+    ok(ret, "CreateProcess failed, error %lu.\n", GetLastError());
+    if (ret)
+    {
+        wait_child_process(info.hProcess);
+        CloseHandle(info.hProcess);
+        CloseHandle(info.hThread);
+    }
+
+    ret = DeleteFileA(font_path);
+    ok(ret, "Failed to delete font file, error %lu.\n", GetLastError());
+}
+
 START_TEST(font)
 {
     static const char *test_names[] =
@@ -7761,9 +7812,13 @@ START_TEST(font)
     {
         if (!strcmp(argv[2], "AddFontMemResource"))
             test_AddFontMemResource();
+        else if (!strcmp(argv[2], "FontDirectory"))
+            ok(is_truetype_font_installed("wine_test"), "Font wine_test should be enumerated.\n");
         return;
     }
 
+    /* run before the tests which add wine_test through AddFontResource */
+    test_font_directory();
     test_stock_fonts();
     test_logfont();
     test_bitmap_font();
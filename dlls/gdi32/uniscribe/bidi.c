@@ -1082,6 +1082,15 @@ search:
     heap_free(runs);
 }
 
+static BOOL onlyLeftToRight(const WCHAR *lpString, unsigned int uCount)
+{
+    unsigned int i;
+
+    for (i = 0; i < uCount; i++)
+        if (lpString[i] >= 0x0590) return FALSE;
+    return TRUE;
+}
+
 /*************************************************************
  *    BIDI_DetermineLevels
  */
@@ -1101,6 +1110,14 @@ BOOL BIDI_DetermineLevels(
 
     TRACE("%s, %d\n", debugstr_wn(lpString, uCount), uCount);
 
+    /* nothing below the Hebrew block can raise a level in an LTR paragraph */
+    if (!s->uBidiLevel && !s->fOverrideDirection && onlyLeftToRight(lpString, uCount))
+    {
+        memset(lpOutLevels, 0, sizeof(WORD) * uCount);
+        memset(lpOutOverrides, 0, sizeof(WORD) * uCount);
+        return TRUE;
+    }
+
     if (!(chartype = heap_alloc(uCount * sizeof(*chartype))))
     {
         WARN("Out of memory\n");
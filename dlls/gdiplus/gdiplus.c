@@ -18,6 +18,9 @@
 
 #include <stdarg.h>
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "windef.h"
 #include "winbase.h"
@@ -448,7 +451,30 @@ void convert_32bppARGB_to_32bppPARGB(UINT width, UINT height,
     {
         const BYTE *src=src_bits+y*src_stride;
         BYTE *dst=dst_bits+y*dst_stride;
-        for (x=0; x<width; x++)
+
+        x = 0;
+#ifdef __SSE2__
+        /* Same computation on four pixels at a time, using 16-bit lanes. For
+         * t < 65536, t / 255 == (t + (t >> 8) + 1) >> 8. */
+        for (; x + 4 <= width; x += 4, src += 16, dst += 16)
+        {
+            const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(127);
+            const __m128i alpha_mask = _mm_set1_epi32(0xff000000), one = _mm_set1_epi16(1);
+            __m128i pixels = _mm_loadu_si128((const __m128i *)src);
+            __m128i lo = _mm_unpacklo_epi8(pixels, zero), hi = _mm_unpackhi_epi8(pixels, zero);
+            __m128i alpha_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xff), 0xff);
+            __m128i alpha_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xff), 0xff);
+
+            lo = _mm_add_epi16(_mm_mullo_epi16(lo, alpha_lo), round);
+            hi = _mm_add_epi16(_mm_mullo_epi16(hi, alpha_hi), round);
+            lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), one), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), one), 8);
+            pixels = _mm_or_si128(_mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo, hi)),
+                                  _mm_and_si128(alpha_mask, pixels));
+            _mm_storeu_si128((__m128i *)dst, pixels);
+        }
+#endif
+        for (; x<width; x++)
         {
             BYTE alpha=src[3];
             *dst++ = (*src++ * alpha + 127) / 255;
@@ -19,6 +19,9 @@
 #include <stdarg.h>
 #include <math.h>
 #include <limits.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "windef.h"
 #include "winbase.h"
@@ -412,6 +415,51 @@ static GpStatus get_clip_hrgn(GpGraphics *graphics, HRGN *hrgn)
     return stat;
 }
 
+static inline void blend_argb_pixel(ARGB *dst, ARGB src, CompositingMode comp_mode, PixelFormat fmt)
+{
+    if (comp_mode == CompositingModeSourceCopy)
+        *dst = (src & 0xff000000) ? src : 0;
+    else if (!(src & 0xff000000))
+        return;
+    else if (fmt & PixelFormatPAlpha)
+        *dst = color_over_fgpremult(*dst, src);
+    else
+        *dst = color_over(*dst, src);
+}
+
+/* Blend a row of ARGB data onto a 32bppARGB row, with the same results as
+ * going through GdipBitmapGetPixel and GdipBitmapSetPixel. */
+static void blend_argb_row(ARGB *dst, const ARGB *src, INT count, CompositingMode comp_mode, PixelFormat fmt)
+{
+    INT x = 0;
+#ifdef __SSE2__
+    const __m128i alpha_mask = _mm_set1_epi32(0xff000000), zero = _mm_setzero_si128();
+
+    /* Groups of pixels which are all opaque or all transparent don't need
+     * any blending, which is the common case for most images. */
+    for (; x + 4 <= count; x += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i alpha = _mm_and_si128(pixels, alpha_mask);
+        __m128i clear = _mm_cmpeq_epi32(alpha, zero);
+        INT i;
+
+        if (comp_mode == CompositingModeSourceCopy)
+            _mm_storeu_si128((__m128i *)(dst + x), _mm_andnot_si128(clear, pixels));
+        else if (_mm_movemask_epi8(clear) == 0xffff)
+            continue;
+        else if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) == 0xffff)
+            _mm_storeu_si128((__m128i *)(dst + x), pixels);
+        else
+            for (i = 0; i < 4; i++)
+                blend_argb_pixel(dst + x + i, src[x + i], comp_mode, fmt);
+    }
+#endif
+
+    for (; x < count; x++)
+        blend_argb_pixel(dst + x, src[x], comp_mode, fmt);
+}
+
 /* Draw ARGB data to the given graphics object */
 static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     const BYTE *src, INT src_width, INT src_height, INT src_stride, const PixelFormat fmt)
@@ -422,6 +470,20 @@ static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_
 
     GdipGetCompositingMode(graphics, &comp_mode);
 
+    if (dst_bitmap->format == PixelFormat32bppARGB)
+    {
+        /* Access the bits directly, pixels outside of the bitmap are ignored. */
+        INT left = max(dst_x, 0), top = max(dst_y, 0);
+        INT right = min(dst_x + src_width, dst_bitmap->width);
+        INT bottom = min(dst_y + src_height, dst_bitmap->height);
+
+        for (y = top; y < bottom; y++)
+            blend_argb_row((ARGB *)(dst_bitmap->bits + dst_bitmap->stride * y) + left,
+                           (const ARGB *)(src + src_stride * (y - dst_y)) + (left - dst_x),
+                           right - left, comp_mode, fmt);
+        return Ok;
+    }
+
     for (y=0; y<src_height; y++)
     {
         for (x=0; x<src_width; x++)
@@ -1278,11 +1340,30 @@ static GpStatus brush_fill_pixels(GpGraphics *graphics, GpBrush *brush,
 
             for (y=0; y<fill_area->Height; y++)
             {
+                ARGB *row = argb_pixels + y * cdwStride;
+
+                if (y && y_delta == 0.0)
+                {
+                    /* horizontal gradient, all rows are the same */
+                    memcpy(row, argb_pixels, fill_area->Width * sizeof(ARGB));
+                    continue;
+                }
+
+                if (x_delta == 0.0)
+                {
+                    /* vertical gradient, the color is constant along the row */
+                    ARGB color = blend_line_gradient(fill, draw_points[0].X + y * y_delta);
+
+                    for (x=0; x<fill_area->Width; x++)
+                        row[x] = color;
+                    continue;
+                }
+
                 for (x=0; x<fill_area->Width; x++)
                 {
                     REAL pos = draw_points[0].X + x * x_delta + y * y_delta;
 
-                    argb_pixels[x + y*cdwStride] = blend_line_gradient(fill, pos);
+                    row[x] = blend_line_gradient(fill, pos);
                 }
             }
         }
@@ -4525,6 +4525,157 @@ static void test_DrawImage_SourceCopy(void)
     expect(Ok, status);
 }
 
+static void test_DrawImage_SourceOver(void)
+{
+    DWORD dst_pixels[6] = { 0xff808080, 0xff808080, 0xff808080,
+                            0xff808080, 0xff808080, 0xff808080 };
+    DWORD src_pixels[8] = { 0xff0000ff, 0xff0000ff, 0xff00ff00, 0x00ff0000,
+                            0xffff0000, 0xff0000ff, 0x0000ff00, 0xffffffff };
+    static const DWORD expected[6] = { 0xff00ff00, 0xff808080, 0xffff0000,
+                                       0xff0000ff, 0xff808080, 0xffffffff };
+    DWORD alpha_src_pixels[8] = { 0x40ff0000, 0xff0000ff, 0x00000000, 0x800000ff,
+                                  0x40ff0000, 0x800000ff, 0x40ff0000, 0x800000ff };
+    static const DWORD alpha_expected[8] = { 0xffffbf00, 0xff0000ff, 0xffffff00, 0xff7f7f80,
+                                             0xffffbf00, 0xff7f7f80, 0xffffbf00, 0xff7f7f80 };
+    DWORD pargb_src_pixels[8] = { 0x80800000, 0xff0000ff, 0x00000000, 0x80800000,
+                                  0x80800000, 0x80000080, 0x80800000, 0x80000080 };
+    static const DWORD pargb_expected[8] = { 0xffff7f00, 0xff0000ff, 0xffffff00, 0xffff7f00,
+                                             0xffff7f00, 0xff7f7f80, 0xffff7f00, 0xff7f7f80 };
+    DWORD alpha_dst_pixels[8];
+    GpStatus status;
+    union
+    {
+        GpBitmap *bitmap;
+        GpImage *image;
+    } u1, u2;
+    GpGraphics *graphics;
+    int i;
+
+    status = GdipCreateBitmapFromScan0(6, 1, 24, PixelFormat32bppARGB, (BYTE*)dst_pixels, &u1.bitmap);
+    expect(Ok, status);
+
+    status = GdipCreateBitmapFromScan0(8, 1, 32, PixelFormat32bppARGB, (BYTE*)src_pixels, &u2.bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext(u1.image, &graphics);
+    expect(Ok, status);
+    status = GdipSetInterpolationMode(graphics, InterpolationModeNearestNeighbor);
+    expect(Ok, status);
+
+    /* partially outside of the destination */
+    status = GdipDrawImageI(graphics, u2.image, -2, 0);
+    expect(Ok, status);
+
+    for (i = 0; i < ARRAY_SIZE(expected); i++)
+        ok(dst_pixels[i] == expected[i], "%d: got %08lx, expected %08lx\n", i, dst_pixels[i], expected[i]);
+
+    status = GdipDeleteGraphics(graphics);
+    expect(Ok, status);
+    status = GdipDisposeImage(u1.image);
+    expect(Ok, status);
+    status = GdipDisposeImage(u2.image);
+    expect(Ok, status);
+
+    /* partially transparent source pixels, mixed with opaque and transparent ones */
+    for (i = 0; i < ARRAY_SIZE(alpha_dst_pixels); i++)
+        alpha_dst_pixels[i] = 0xffffff00;
+
+    status = GdipCreateBitmapFromScan0(8, 1, 32, PixelFormat32bppARGB, (BYTE*)alpha_dst_pixels, &u1.bitmap);
+    expect(Ok, status);
+    status = GdipCreateBitmapFromScan0(8, 1, 32, PixelFormat32bppARGB, (BYTE*)alpha_src_pixels, &u2.bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext(u1.image, &graphics);
+    expect(Ok, status);
+    status = GdipSetInterpolationMode(graphics, InterpolationModeNearestNeighbor);
+    expect(Ok, status);
+
+    status = GdipDrawImageI(graphics, u2.image, 0, 0);
+    expect(Ok, status);
+
+    for (i = 0; i < ARRAY_SIZE(alpha_expected); i++)
+        ok(color_match(alpha_dst_pixels[i], alpha_expected[i], 1), "%d: got %08lx, expected %08lx\n",
+           i, alpha_dst_pixels[i], alpha_expected[i]);
+
+    status = GdipDeleteGraphics(graphics);
+    expect(Ok, status);
+    status = GdipDisposeImage(u1.image);
+    expect(Ok, status);
+    status = GdipDisposeImage(u2.image);
+    expect(Ok, status);
+
+    /* premultiplied source */
+    for (i = 0; i < ARRAY_SIZE(alpha_dst_pixels); i++)
+        alpha_dst_pixels[i] = 0xffffff00;
+
+    status = GdipCreateBitmapFromScan0(8, 1, 32, PixelFormat32bppARGB, (BYTE*)alpha_dst_pixels, &u1.bitmap);
+    expect(Ok, status);
+    status = GdipCreateBitmapFromScan0(8, 1, 32, PixelFormat32bppPARGB, (BYTE*)pargb_src_pixels, &u2.bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext(u1.image, &graphics);
+    expect(Ok, status);
+    status = GdipSetInterpolationMode(graphics, InterpolationModeNearestNeighbor);
+    expect(Ok, status);
+
+    status = GdipDrawImageI(graphics, u2.image, 0, 0);
+    expect(Ok, status);
+
+    for (i = 0; i < ARRAY_SIZE(pargb_expected); i++)
+        ok(color_match(alpha_dst_pixels[i], pargb_expected[i], 1), "%d: got %08lx, expected %08lx\n",
+           i, alpha_dst_pixels[i], pargb_expected[i]);
+
+    status = GdipDeleteGraphics(graphics);
+    expect(Ok, status);
+    status = GdipDisposeImage(u1.image);
+    expect(Ok, status);
+    status = GdipDisposeImage(u2.image);
+    expect(Ok, status);
+}
+
+static void test_FillRectangle_LineGradient(void)
+{
+    static const ARGB horizontal_expected[5] = { 0xff000000, 0xff000033, 0xff000066, 0xff000099, 0xff0000cc };
+    static const ARGB vertical_expected[5] = { 0xff000000, 0xff003300, 0xff006600, 0xff009900, 0xff00cc00 };
+    static const GpPoint start = { 0, 0 }, horizontal_end = { 5, 0 }, vertical_end = { 0, 5 };
+    DWORD pixels[5 * 5];
+    GpLineGradient *brush;
+    GpGraphics *graphics;
+    GpBitmap *bitmap;
+    GpStatus status;
+    int x, y;
+
+    memset(pixels, 0, sizeof(pixels));
+    status = GdipCreateBitmapFromScan0(5, 5, 20, PixelFormat32bppARGB, (BYTE*)pixels, &bitmap);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage*)bitmap, &graphics);
+    expect(Ok, status);
+
+    status = GdipCreateLineBrushI(&start, &horizontal_end, 0xff000000, 0xff0000ff, WrapModeTile, &brush);
+    expect(Ok, status);
+    status = GdipFillRectangleI(graphics, (GpBrush*)brush, 0, 0, 5, 5);
+    expect(Ok, status);
+    GdipDeleteBrush((GpBrush*)brush);
+
+    for (y = 0; y < 5; y++)
+        for (x = 0; x < 5; x++)
+            ok(pixels[y * 5 + x] == horizontal_expected[x], "(%d,%d): got %08lx, expected %08lx\n",
+               x, y, pixels[y * 5 + x], horizontal_expected[x]);
+
+    status = GdipCreateLineBrushI(&start, &vertical_end, 0xff000000, 0xff00ff00, WrapModeTile, &brush);
+    expect(Ok, status);
+    status = GdipFillRectangleI(graphics, (GpBrush*)brush, 0, 0, 5, 5);
+    expect(Ok, status);
+    GdipDeleteBrush((GpBrush*)brush);
+
+    for (y = 0; y < 5; y++)
+        for (x = 0; x < 5; x++)
+            ok(pixels[y * 5 + x] == vertical_expected[y], "(%d,%d): got %08lx, expected %08lx\n",
+               x, y, pixels[y * 5 + x], vertical_expected[y]);
+
+    status = GdipDeleteGraphics(graphics);
+    expect(Ok, status);
+    status = GdipDisposeImage((GpImage*)bitmap);
+    expect(Ok, status);
+}
+
 static void test_GdipDrawImagePointRect(void)
 {
     BYTE black_1x1[4] = { 0,0,0,0 };
@@ -6026,6 +6177,8 @@ START_TEST(image)
     test_image_format();
     test_DrawImage();
     test_DrawImage_SourceCopy();
+    test_DrawImage_SourceOver();
+    test_FillRectangle_LineGradient();
     test_GdipDrawImagePointRect();
     test_bitmapbits();
     test_tiff_palette();
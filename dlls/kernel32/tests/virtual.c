@@ -477,6 +477,64 @@ static void test_VirtualAllocFromApp(void)
             p, GetLastError());
 }
 
+static void test_VirtualAlloc_large_pages(void)
+{
+    MEMORY_BASIC_INFORMATION info;
+    SIZE_T large_page_size;
+    DWORD *addr;
+    BOOL ret;
+
+    large_page_size = GetLargePageMinimum();
+    if (!large_page_size)
+    {
+        skip("Large pages are not supported.\n");
+        return;
+    }
+
+    /* large pages must be reserved and committed at once */
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, large_page_size, MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "got error %lu\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, large_page_size, MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER || broken(GetLastError() == ERROR_PRIVILEGE_NOT_HELD),
+       "got error %lu\n", GetLastError());
+
+    /* in multiples of the large page size */
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, large_page_size / 2, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER || broken(GetLastError() == ERROR_PRIVILEGE_NOT_HELD),
+       "got error %lu\n", GetLastError());
+
+    /* Windows requires SeLockMemoryPrivilege */
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, large_page_size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (!addr)
+    {
+        ok(GetLastError() == ERROR_PRIVILEGE_NOT_HELD, "got error %lu\n", GetLastError());
+        skip("Large pages allocation is not allowed.\n");
+        return;
+    }
+    ok(!((ULONG_PTR)addr & (large_page_size - 1)), "got unaligned address %p\n", addr);
+    ok(!addr[0] && !addr[large_page_size / sizeof(*addr) - 1], "memory is not zeroed\n");
+    addr[0] = 0xdeadbeef;
+    addr[large_page_size / sizeof(*addr) - 1] = 0xdeadbeef;
+
+    ret = VirtualQuery(addr, &info, sizeof(info));
+    ok(ret, "VirtualQuery failed, error %lu\n", GetLastError());
+    ok(info.AllocationBase == addr, "got AllocationBase %p, expected %p\n", info.AllocationBase, addr);
+    ok(info.RegionSize == large_page_size, "got RegionSize %#Ix\n", info.RegionSize);
+    ok(info.State == MEM_COMMIT, "got State %#lx\n", info.State);
+    ok(info.Protect == PAGE_READWRITE, "got Protect %#lx\n", info.Protect);
+
+    ret = VirtualFree(addr, 0, MEM_RELEASE);
+    ok(ret, "VirtualFree failed, error %lu\n", GetLastError());
+}
+
 static void test_MapViewOfFile(void)
 {
     static const char testfile[] = "testfile.xxx";
@@ -2162,6 +2220,77 @@ static void test_write_watch(void)
     VirtualFree( base, 0, MEM_RELEASE );
 }
 
+static void test_write_watch_decommit(void)
+{
+    void *results[64];
+    ULONG_PTR count;
+    ULONG pagesize;
+    SIZE_T size;
+    char *base, *ptr;
+    DWORD ret;
+
+    if (!pGetWriteWatch)
+    {
+        win_skip( "GetWriteWatch not supported\n" );
+        return;
+    }
+
+    size = 0x100000;
+    base = VirtualAlloc( 0, size, MEM_RESERVE | MEM_COMMIT | MEM_WRITE_WATCH, PAGE_READWRITE );
+    if (!base)
+    {
+        win_skip( "MEM_WRITE_WATCH not supported\n" );
+        return;
+    }
+
+    count = 64;
+    ret = pGetWriteWatch( 0, base, size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %lu\n", GetLastError() );
+    ok( count == 0, "wrong count %Iu\n", count );
+
+    base[0] = 1;
+    base[size - 1] = 1;
+
+    count = 64;
+    ret = pGetWriteWatch( WRITE_WATCH_FLAG_RESET, base, size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %lu\n", GetLastError() );
+    ok( count == 2, "wrong count %Iu\n", count );
+    ok( results[0] == base, "wrong result %p\n", results[0] );
+    ok( results[1] == base + size - pagesize, "wrong result %p\n", results[1] );
+
+    /* writes to recommitted pages are still reported */
+
+    ret = VirtualFree( base + 4*pagesize, 4*pagesize, MEM_DECOMMIT );
+    ok( ret, "VirtualFree failed %lu\n", GetLastError() );
+    ptr = VirtualAlloc( base + 4*pagesize, 4*pagesize, MEM_COMMIT, PAGE_READWRITE );
+    ok( ptr == base + 4*pagesize, "VirtualAlloc failed %lu\n", GetLastError() );
+
+    count = 64;
+    ret = pGetWriteWatch( 0, base, size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %lu\n", GetLastError() );
+    ok( count == 0, "wrong count %Iu\n", count );
+
+    base[pagesize] = 1;
+    base[5*pagesize] = 1;
+
+    count = 64;
+    ret = pGetWriteWatch( WRITE_WATCH_FLAG_RESET, base, size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %lu\n", GetLastError() );
+    ok( count == 2, "wrong count %Iu\n", count );
+    ok( results[0] == base + pagesize, "wrong result %p\n", results[0] );
+    ok( results[1] == base + 5*pagesize, "wrong result %p\n", results[1] );
+
+    base[5*pagesize + 1] = 1;
+
+    count = 64;
+    ret = pGetWriteWatch( 0, base, size, results, &count, &pagesize );
+    ok( !ret, "GetWriteWatch failed %lu\n", GetLastError() );
+    ok( count == 1, "wrong count %Iu\n", count );
+    ok( results[0] == base + 5*pagesize, "wrong result %p\n", results[0] );
+
+    VirtualFree( base, 0, MEM_RELEASE );
+}
+
 #if defined(__i386__) || defined(__x86_64__)
 
 static DWORD WINAPI stack_commit_func( void *arg )
@@ -4310,6 +4439,7 @@ START_TEST(virtual)
     test_VirtualAllocEx();
     test_VirtualAlloc();
     test_VirtualAllocFromApp();
+    test_VirtualAlloc_large_pages();
     test_MapViewOfFile();
     test_NtAreMappedFilesTheSame();
     test_CreateFileMapping();
@@ -4317,6 +4447,7 @@ START_TEST(virtual)
     test_IsBadWritePtr();
     test_IsBadCodePtr();
     test_write_watch();
+    test_write_watch_decommit();
 #if defined(__i386__) || defined(__x86_64__)
     test_stack_commit();
 #endif
@@ -60,6 +60,32 @@ static WCHAR casemap_ascii( WCHAR ch )
 }
 
 
+/* upcase a char, avoiding the table lookups for ASCII chars */
+static inline WCHAR casemap_upper( WCHAR ch )
+{
+    if (ch < 0x80 || !nls_info.UpperCaseTable) return casemap_ascii( ch );  /* locale may not be setup yet */
+    return casemap( nls_info.UpperCaseTable, ch );
+}
+
+
+/* return the length of the common prefix of two strings, comparing a machine word at a time */
+static inline SIZE_T common_prefix_len( const WCHAR *s1, const WCHAR *s2, SIZE_T len )
+{
+    const SIZE_T word_len = sizeof(ULONG_PTR) / sizeof(WCHAR);
+    SIZE_T i = 0;
+
+    if (!(((ULONG_PTR)s1 ^ (ULONG_PTR)s2) & (sizeof(ULONG_PTR) - 1)))
+    {
+        for (; i < len && ((ULONG_PTR)(s1 + i) & (sizeof(ULONG_PTR) - 1)); i++)
+            if (s1[i] != s2[i]) return i;
+        for (; len - i >= word_len; i += word_len)
+            if (*(const ULONG_PTR *)(s1 + i) != *(const ULONG_PTR *)(s2 + i)) break;
+    }
+    for (; i < len; i++) if (s1[i] != s2[i]) break;
+    return i;
+}
+
+
 static NTSTATUS load_norm_table( ULONG form, const struct norm_table **info )
 {
     unsigned int i;
@@ -459,23 +485,17 @@ LONG WINAPI RtlCompareUnicodeStrings( const WCHAR *s1, SIZE_T len1, const WCHAR
                                       BOOLEAN case_insensitive )
 {
     LONG ret = 0;
-    SIZE_T len = min( len1, len2 );
+    SIZE_T i, len = min( len1, len2 );
 
-    if (case_insensitive)
-    {
-        if (nls_info.UpperCaseTable)
-        {
-            while (!ret && len--) ret = casemap( nls_info.UpperCaseTable, *s1++ ) -
-                                        casemap( nls_info.UpperCaseTable, *s2++ );
-        }
-        else  /* locale not setup yet */
-        {
-            while (!ret && len--) ret = casemap_ascii( *s1++ ) - casemap_ascii( *s2++ );
-        }
-    }
-    else
+    /* only the chars that differ need to be case mapped */
+    while ((i = common_prefix_len( s1, s2, len )) < len)
     {
-        while (!ret && len--) ret = *s1++ - *s2++;
+        if (case_insensitive) ret = casemap_upper( s1[i] ) - casemap_upper( s2[i] );
+        else ret = s1[i] - s2[i];
+        if (ret) break;
+        s1 += i + 1;
+        s2 += i + 1;
+        len -= i + 1;
     }
     if (!ret) ret = len1 - len2;
     return ret;
@@ -494,8 +514,8 @@ BOOLEAN WINAPI RtlPrefixUnicodeString( const UNICODE_STRING *s1, const UNICODE_S
     if (ignore_case)
     {
         for (i = 0; i < s1->Length / sizeof(WCHAR); i++)
-            if (casemap( nls_info.UpperCaseTable, s1->Buffer[i] ) !=
-                casemap( nls_info.UpperCaseTable, s2->Buffer[i] )) return FALSE;
+            if (s1->Buffer[i] != s2->Buffer[i] &&
+                casemap_upper( s1->Buffer[i] ) != casemap_upper( s2->Buffer[i] )) return FALSE;
     }
     else
     {
@@ -530,12 +550,9 @@ NTSTATUS WINAPI RtlHashUnicodeString( const UNICODE_STRING *string, BOOLEAN case
     if (!case_insensitive)
         for (i = 0; i < string->Length / sizeof(WCHAR); i++)
             *hash = *hash * 65599 + string->Buffer[i];
-    else if (nls_info.UpperCaseTable)
-        for (i = 0; i < string->Length / sizeof(WCHAR); i++)
-            *hash = *hash * 65599 + casemap( nls_info.UpperCaseTable, string->Buffer[i] );
-    else  /* locale not setup yet */
+    else
         for (i = 0; i < string->Length / sizeof(WCHAR); i++)
-            *hash = *hash * 65599 + casemap_ascii( string->Buffer[i] );
+            *hash = *hash * 65599 + casemap_upper( string->Buffer[i] );
     return STATUS_SUCCESS;
 }
 
@@ -762,7 +779,7 @@ NTSTATUS WINAPI RtlUpcaseUnicodeString( UNICODE_STRING *dest, const UNICODE_STRI
     else if (len > dest->MaximumLength) return STATUS_BUFFER_OVERFLOW;
 
     for (i = 0; i < len / sizeof(WCHAR); i++)
-        dest->Buffer[i] = casemap( nls_info.UpperCaseTable, src->Buffer[i] );
+        dest->Buffer[i] = casemap_upper( src->Buffer[i] );
     dest->Length = len;
     return STATUS_SUCCESS;
 }
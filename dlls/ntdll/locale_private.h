@@ -231,15 +231,51 @@ static inline unsigned int cp_wcstombs_size( const CPTABLEINFO *info, const WCHA
 }
 
 
+/* return the length of the leading run of 7-bit ASCII chars, checking a machine word at a time */
+static inline unsigned int ascii_mbs_len( const char *src, unsigned int srclen )
+{
+    static const ULONG_PTR high_bits = (ULONG_PTR)0x8080808080808080;
+    const char *ptr = src, *end = src + srclen;
+
+    for (; ptr < end && ((ULONG_PTR)ptr & (sizeof(ULONG_PTR) - 1)); ptr++)
+        if (*ptr & 0x80) return ptr - src;
+    for (; end - ptr >= sizeof(ULONG_PTR); ptr += sizeof(ULONG_PTR))
+        if (*(const ULONG_PTR *)ptr & high_bits) break;
+    for (; ptr < end; ptr++) if (*ptr & 0x80) break;
+    return ptr - src;
+}
+
+
+/* return the length of the leading run of 7-bit ASCII chars, checking a machine word at a time */
+static inline unsigned int ascii_wcs_len( const WCHAR *src, unsigned int srclen )
+{
+    static const ULONG_PTR high_bits = (ULONG_PTR)0xff80ff80ff80ff80;
+    const WCHAR *ptr = src, *end = src + srclen;
+
+    for (; ptr < end && ((ULONG_PTR)ptr & (sizeof(ULONG_PTR) - 1)); ptr++)
+        if (*ptr >= 0x80) return ptr - src;
+    for (; end - ptr >= sizeof(ULONG_PTR) / sizeof(WCHAR); ptr += sizeof(ULONG_PTR) / sizeof(WCHAR))
+        if (*(const ULONG_PTR *)ptr & high_bits) break;
+    for (; ptr < end; ptr++) if (*ptr >= 0x80) break;
+    return ptr - src;
+}
+
+
 static inline NTSTATUS utf8_wcstombs_size( const WCHAR *src, unsigned int srclen, unsigned int *reslen )
 {
-    unsigned int val, len;
+    unsigned int val, len, ascii;
     NTSTATUS status = STATUS_SUCCESS;
 
     for (len = 0; srclen; srclen--, src++)
     {
-        if (*src < 0x80) len++;  /* 0x00-0x7f: 1 byte */
-        else if (*src < 0x800) len += 2;  /* 0x80-0x7ff: 2 bytes */
+        if ((ascii = ascii_wcs_len( src, srclen )))
+        {
+            len += ascii;
+            src += ascii - 1;
+            srclen -= ascii - 1;
+            continue;
+        }
+        if (*src < 0x800) len += 2;  /* 0x80-0x7ff: 2 bytes */
         else
         {
             if (!get_utf16( src, srclen, &val ))
@@ -263,14 +299,21 @@ static inline NTSTATUS utf8_wcstombs_size( const WCHAR *src, unsigned int srclen
 
 static inline NTSTATUS utf8_mbstowcs_size( const char *src, unsigned int srclen, unsigned int *reslen )
 {
-    unsigned int res, len;
+    unsigned int res, len, ascii;
     NTSTATUS status = STATUS_SUCCESS;
     const char *srcend = src + srclen;
 
     for (len = 0; src < srcend; len++)
     {
-        unsigned char ch = *src++;
-        if (ch < 0x80) continue;
+        unsigned char ch;
+
+        if ((ascii = ascii_mbs_len( src, srcend - src )))
+        {
+            src += ascii;
+            len += ascii - 1;
+            continue;
+        }
+        ch = *src++;
         if ((res = decode_utf8_char( ch, &src, srcend )) > 0x10ffff)
             status = STATUS_SOME_NOT_MAPPED;
         else
@@ -344,19 +387,24 @@ static inline unsigned int cp_wcstombs( const CPTABLEINFO *info, char *dst, unsi
 static inline NTSTATUS utf8_mbstowcs( WCHAR *dst, unsigned int dstlen, unsigned int *reslen,
                                       const char *src, unsigned int srclen )
 {
-    unsigned int res;
+    unsigned int i, res, ascii;
     NTSTATUS status = STATUS_SUCCESS;
     const char *srcend = src + srclen;
     WCHAR *dstend = dst + dstlen;
 
     while ((dst < dstend) && (src < srcend))
     {
-        unsigned char ch = *src++;
-        if (ch < 0x80)  /* special fast case for 7-bit ASCII */
+        unsigned char ch;
+
+        /* special fast case for runs of 7-bit ASCII */
+        if ((ascii = ascii_mbs_len( src, min( srcend - src, dstend - dst ))))
         {
-            *dst++ = ch;
+            for (i = 0; i < ascii; i++) dst[i] = (unsigned char)src[i];
+            src += ascii;
+            dst += ascii;
             continue;
         }
+        ch = *src++;
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
         {
             *dst++ = res;
@@ -384,7 +432,7 @@ static inline NTSTATUS utf8_wcstombs( char *dst, unsigned int dstlen, unsigned i
                                       const WCHAR *src, unsigned int srclen )
 {
     char *end;
-    unsigned int val;
+    unsigned int i, val, ascii;
     NTSTATUS status = STATUS_SUCCESS;
 
     for (end = dst + dstlen; srclen; srclen--, src++)
@@ -394,7 +442,11 @@ static inline NTSTATUS utf8_wcstombs( char *dst, unsigned int dstlen, unsigned i
         if (ch < 0x80)  /* 0x00-0x7f: 1 byte */
         {
             if (dst > end - 1) break;
-            *dst++ = ch;
+            ascii = ascii_wcs_len( src, min( srclen, end - dst ));
+            for (i = 0; i < ascii; i++) dst[i] = src[i];
+            dst += ascii;
+            src += ascii - 1;
+            srclen -= ascii - 1;
             continue;
         }
         if (ch < 0x800)  /* 0x80-0x7ff: 2 bytes */
@@ -1897,6 +1897,41 @@ static void test_RtlCompareUnicodeString(void)
             }
         }
     }
+
+    /* longer strings, with a difference at every position and alignment */
+    if (pRtlCompareUnicodeStrings)
+    {
+        static const WCHAR pathW[] = L"c:\\windows\\system32\\drivers\\etc\\h\x00f4sts.txt";
+        WCHAR buf1[64], buf2[64];
+        unsigned int len = wcslen( pathW ), offset, pos, i;
+        LONG res;
+
+        for (offset = 0; offset < 4; offset++)
+        {
+            for (i = 0; i < len; i++)
+            {
+                buf1[offset + i] = pathW[i];
+                buf2[i] = pRtlUpcaseUnicodeChar( pathW[i] );
+            }
+            res = pRtlCompareUnicodeStrings( buf1 + offset, len, buf2, len, TRUE );
+            ok( !res, "%u: wrong result %ld\n", offset, res );
+            res = pRtlCompareUnicodeStrings( buf1 + offset, len, buf2, len, FALSE );
+            ok( res > 0, "%u: wrong result %ld\n", offset, res );
+            res = pRtlCompareUnicodeStrings( buf1 + offset, len, buf1 + offset, len - 1, TRUE );
+            ok( res == 1, "%u: wrong result %ld\n", offset, res );
+
+            for (pos = 0; pos < len; pos++)
+            {
+                memcpy( buf2, buf1 + offset, len * sizeof(WCHAR) );
+                buf2[pos] = 0x100;
+                res = pRtlCompareUnicodeStrings( buf1 + offset, len, buf2, len, TRUE );
+                ok( res == pRtlUpcaseUnicodeChar( pathW[pos] ) - 0x100, "%u/%u: wrong result %ld\n",
+                    offset, pos, res );
+                res = pRtlCompareUnicodeStrings( buf1 + offset, len, buf2, len, FALSE );
+                ok( res == pathW[pos] - 0x100, "%u/%u: wrong result %ld\n", offset, pos, res );
+            }
+        }
+    }
 }
 
 static const WCHAR szGuid[] = { '{','0','1','0','2','0','3','0','4','-',
@@ -2890,6 +2925,68 @@ static void test_RtlFormatMessage(void)
 
 }
 
+static void test_utf8_ascii_runs(void)
+{
+    static const char ascii[] = "The quick brown fox jumps over the lazy dog 0123456789";
+    char utf8[128], out[128];
+    WCHAR bufferW[128], expectW[128];
+    unsigned int len = strlen(ascii), pos, start, i, j;
+    ULONG bytes_out;
+    NTSTATUS status;
+
+    if (!pRtlUTF8ToUnicodeN || !pRtlUnicodeToUTF8N)
+    {
+        skip("RtlUTF8ToUnicodeN or RtlUnicodeToUTF8N unavailable\n");
+        return;
+    }
+
+    /* a two-byte sequence at every position, with every source alignment */
+    for (start = 0; start < 8; start++)
+    {
+        for (pos = start; pos < len; pos++)
+        {
+            for (i = j = 0; i < len; i++)
+            {
+                if (i == pos)
+                {
+                    utf8[j++] = 0xc3;
+                    utf8[j++] = 0xa9;
+                    expectW[i] = 0xe9;
+                }
+                else
+                {
+                    utf8[j++] = ascii[i];
+                    expectW[i] = ascii[i];
+                }
+            }
+
+            memset(bufferW, 0x55, sizeof(bufferW));
+            status = pRtlUTF8ToUnicodeN(bufferW, sizeof(bufferW), &bytes_out, utf8 + start, j - start);
+            ok(status == STATUS_SUCCESS, "%u/%u: status = 0x%lx\n", start, pos, status);
+            ok(bytes_out == (len - start) * sizeof(WCHAR), "%u/%u: bytes_out = %lu\n", start, pos, bytes_out);
+            ok(!memcmp(bufferW, expectW + start, bytes_out), "%u/%u: got %s\n", start, pos,
+               wine_dbgstr_wn(bufferW, bytes_out / sizeof(WCHAR)));
+            ok(bufferW[len - start] == 0x5555, "%u/%u: behind string: 0x%x\n", start, pos, bufferW[len - start]);
+
+            memset(out, 0x55, sizeof(out));
+            status = pRtlUnicodeToUTF8N(out, sizeof(out), &bytes_out, expectW + start, (len - start) * sizeof(WCHAR));
+            ok(status == STATUS_SUCCESS, "%u/%u: status = 0x%lx\n", start, pos, status);
+            ok(bytes_out == j - start, "%u/%u: bytes_out = %lu\n", start, pos, bytes_out);
+            ok(!memcmp(out, utf8 + start, bytes_out), "%u/%u: got %s\n", start, pos, debugstr_an(out, bytes_out));
+            ok(out[j - start] == 0x55, "%u/%u: behind string: 0x%x\n", start, pos, out[j - start]);
+
+            /* truncated output in the middle of an ASCII run */
+            memset(bufferW, 0x55, sizeof(bufferW));
+            status = pRtlUTF8ToUnicodeN(bufferW, 9 * sizeof(WCHAR), &bytes_out, utf8 + start, j - start);
+            ok(status == STATUS_BUFFER_TOO_SMALL, "%u/%u: status = 0x%lx\n", start, pos, status);
+            ok(bytes_out == 9 * sizeof(WCHAR), "%u/%u: bytes_out = %lu\n", start, pos, bytes_out);
+            ok(!memcmp(bufferW, expectW + start, bytes_out), "%u/%u: got %s\n", start, pos,
+               wine_dbgstr_wn(bufferW, bytes_out / sizeof(WCHAR)));
+            ok(bufferW[9] == 0x5555, "%u/%u: behind string: 0x%x\n", start, pos, bufferW[9]);
+        }
+    }
+}
+
 START_TEST(rtlstr)
 {
     InitFunctionPtrs();
@@ -2923,5 +3020,6 @@ START_TEST(rtlstr)
     test_RtlHashUnicodeString();
     test_RtlUnicodeToUTF8N();
     test_RtlUTF8ToUnicodeN();
+    test_utf8_ascii_runs();
     test_RtlFormatMessage();
 }
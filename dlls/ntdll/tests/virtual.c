@@ -1132,6 +1132,78 @@ static void test_syscalls(void)
     UnmapViewOfFile( ptr );
 }
 
+static LONG query_thread_done;
+
+static DWORD WINAPI alloc_protect_thread( void *arg )
+{
+    NTSTATUS status;
+    SIZE_T size;
+    ULONG old_prot;
+    void *addr;
+    int i;
+
+    for (i = 0; i < 5000 && !query_thread_done; i++)
+    {
+        addr = NULL;
+        size = 0x10000;
+        status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_RESERVE | MEM_COMMIT,
+                                          PAGE_READWRITE );
+        ok( !status, "NtAllocateVirtualMemory returned %08lx\n", status );
+        size = page_size;
+        status = NtProtectVirtualMemory( NtCurrentProcess(), &addr, &size, PAGE_READONLY, &old_prot );
+        ok( !status, "NtProtectVirtualMemory returned %08lx\n", status );
+        size = 0;
+        status = NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+        ok( !status, "NtFreeVirtualMemory returned %08lx\n", status );
+    }
+    return 0;
+}
+
+static void test_concurrent_query(void)
+{
+    MEMORY_BASIC_INFORMATION mbi;
+    NTSTATUS status;
+    HANDLE thread;
+    SIZE_T size;
+    void *addr = NULL;
+    unsigned int i;
+
+    size = 0x10000;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_RESERVE, PAGE_READWRITE );
+    ok( !status, "NtAllocateVirtualMemory returned %08lx\n", status );
+    size = 2 * page_size;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_COMMIT, PAGE_READWRITE );
+    ok( !status, "NtAllocateVirtualMemory returned %08lx\n", status );
+
+    query_thread_done = 0;
+    thread = CreateThread( NULL, 0, alloc_protect_thread, NULL, 0, NULL );
+    ok( thread != NULL, "CreateThread failed %lu\n", GetLastError() );
+
+    /* queries of an unrelated range must stay consistent while other views change */
+    for (i = 0; i < 20000; i++)
+    {
+        status = NtQueryVirtualMemory( NtCurrentProcess(), (char *)addr + page_size, MemoryBasicInformation,
+                                       &mbi, sizeof(mbi), NULL );
+        ok( !status, "NtQueryVirtualMemory returned %08lx\n", status );
+        if (status || mbi.AllocationBase != addr || mbi.BaseAddress != (char *)addr + page_size ||
+            mbi.RegionSize != page_size || mbi.State != MEM_COMMIT || mbi.Protect != PAGE_READWRITE ||
+            mbi.Type != MEM_PRIVATE)
+        {
+            ok( 0, "iteration %u: got base %p/%p size %#Ix state %#lx prot %#lx type %#lx\n", i,
+                mbi.AllocationBase, mbi.BaseAddress, mbi.RegionSize, mbi.State, mbi.Protect, mbi.Type );
+            break;
+        }
+    }
+
+    InterlockedExchange( &query_thread_done, 1 );
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+
+    size = 0;
+    status = NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    ok( !status, "NtFreeVirtualMemory returned %08lx\n", status );
+}
+
 START_TEST(virtual)
 {
     HMODULE mod;
@@ -1171,4 +1243,5 @@ START_TEST(virtual)
     test_NtMapViewOfSection();
     test_user_shared_data();
     test_syscalls();
+    test_concurrent_query();
 }
@@ -51,6 +51,13 @@
 #ifdef HAVE_SYS_USER_H
 # include <sys/user.h>
 #endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
+#include <sys/ioctl.h>
+#ifdef HAVE_LINUX_USERFAULTFD_H
+# include <linux/userfaultfd.h>
+#endif
 #ifdef HAVE_LIBPROCSTAT_H
 # include <libprocstat.h>
 #endif
@@ -121,6 +128,7 @@ struct file_view
 #define VPROT_WRITEWATCH 0x40
 /* per-mapping protection flags */
 #define VPROT_SYSTEM     0x0200  /* system view (underlying mmap not under our control) */
+#define VPROT_KERNEL_WRITEWATCH 0x0400  /* write watches are tracked by the kernel */
 
 /* Conversion from VPROT_* to Win32 flags */
 static const BYTE VIRTUAL_Win32Flags[16] =
@@ -145,10 +153,13 @@ static const BYTE VIRTUAL_Win32Flags[16] =
 
 static struct wine_rb_tree views_tree;
 static pthread_mutex_t virtual_mutex;
+static LONG views_seq;                  /* changes around every view update, odd while one is in progress */
+static unsigned int views_write_depth;  /* nesting level of view updates, protected by virtual_mutex */
 
 static const UINT page_shift = 12;
 static const UINT_PTR page_mask = 0xfff;
 static const UINT_PTR granularity_mask = 0xffff;
+static const UINT_PTR large_page_mask = 0x1fffff;  /* must match GetLargePageMinimum() */
 
 /* Note: these are Windows limits, you cannot change them. */
 #ifdef __i386__
@@ -204,6 +215,7 @@ static const size_t view_block_size = 0x100000;
 static void *preload_reserve_start;
 static void *preload_reserve_end;
 static BOOL force_exec_prot;  /* whether to force PROT_EXEC on all PROT_READ mmaps */
+static BOOL huge_page_hint;   /* whether to request transparent huge pages for large allocations */
 
 struct range_entry
 {
@@ -928,6 +940,54 @@ static SIZE_T get_vprot_range_size( char *base, SIZE_T size, BYTE mask, BYTE *vp
     return size;
 }
 
+/***********************************************************************
+ *           views_write_begin
+ *
+ * Start an update of the views tree, the view fields or the page protection bytes,
+ * so that lock-free readers can detect it. virtual_mutex must be held by caller.
+ */
+static inline void views_write_begin(void)
+{
+    if (!views_write_depth++) InterlockedIncrement( &views_seq );
+}
+
+
+/***********************************************************************
+ *           views_write_end
+ *
+ * End an update started with views_write_begin. virtual_mutex must be held by caller.
+ */
+static inline void views_write_end(void)
+{
+    if (!--views_write_depth) InterlockedIncrement( &views_seq );
+}
+
+
+/***********************************************************************
+ *           views_read_begin
+ *
+ * Start a lock-free read of the views; returns the sequence number to check against.
+ */
+static inline LONG views_read_begin(void)
+{
+    LONG seq = *(volatile LONG *)&views_seq;
+    MemoryBarrier();
+    return seq;
+}
+
+
+/***********************************************************************
+ *           views_read_retry
+ *
+ * Check whether data read since views_read_begin may be inconsistent.
+ */
+static inline BOOL views_read_retry( LONG seq )
+{
+    MemoryBarrier();
+    return (seq & 1) || *(volatile LONG *)&views_seq != seq;
+}
+
+
 /***********************************************************************
  *           set_page_vprot
  *
@@ -938,6 +998,7 @@ static void set_page_vprot( const void *addr, size_t size, BYTE vprot )
     size_t idx = (size_t)addr >> page_shift;
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
+    views_write_begin();
 #ifdef _WIN64
     while (idx >> pages_vprot_shift != end >> pages_vprot_shift)
     {
@@ -949,6 +1010,7 @@ static void set_page_vprot( const void *addr, size_t size, BYTE vprot )
 #else
     memset( pages_vprot + idx, vprot, end - idx );
 #endif
+    views_write_end();
 }
 
 
@@ -962,6 +1024,7 @@ static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE c
     size_t idx = (size_t)addr >> page_shift;
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
 
+    views_write_begin();
 #ifdef _WIN64
     for ( ; idx < end; idx++)
     {
@@ -971,6 +1034,7 @@ static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE c
 #else
     for ( ; idx < end; idx++) pages_vprot[idx] = (pages_vprot[idx] & ~clear) | set;
 #endif
+    views_write_end();
 }
 
 
@@ -1140,6 +1204,49 @@ static struct file_view *find_view( const void *addr, size_t size )
 }
 
 
+/***********************************************************************
+ *           find_view_nolock
+ *
+ * Lock-free version of find_view. On success, a consistent copy of the view
+ * is returned in *ret, with a zero size if there is no view at that address.
+ * Returns FALSE if a concurrent update was detected; the caller should then
+ * fall back to the locked path. Views are never unmapped once allocated, so
+ * the racy tree walk can only see stale entries, not invalid memory.
+ */
+static BOOL find_view_nolock( const void *addr, size_t size, struct file_view *ret, LONG *seq )
+{
+    struct wine_rb_entry *ptr;
+    unsigned int depth = 0;
+
+    if ((const char *)addr + size < (const char *)addr) return FALSE; /* overflow */
+
+    *seq = views_read_begin();
+    ret->size = 0;
+    ptr = views_tree.root;
+    while (ptr)
+    {
+        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+        char *base = view->base;
+        size_t view_size = view->size;
+
+        if (++depth > 2 * sizeof(void *) * 8) return FALSE;  /* deeper than any valid tree */
+        if (base > (const char *)addr) ptr = ptr->left;
+        else if (base + view_size <= (const char *)addr) ptr = ptr->right;
+        else
+        {
+            if (base + view_size >= (const char *)addr + size)
+            {
+                ret->base    = base;
+                ret->size    = view_size;
+                ret->protect = view->protect;
+            }
+            break;
+        }
+    }
+    return !views_read_retry( *seq );
+}
+
+
 /***********************************************************************
  *           get_zero_bits_mask
  */
@@ -1176,6 +1283,16 @@ static inline BOOL is_write_watch_range( const void *addr, size_t size )
 }
 
 
+/***********************************************************************
+ *           is_kernel_write_watch_range
+ */
+static inline BOOL is_kernel_write_watch_range( const void *addr, size_t size )
+{
+    struct file_view *view = find_view( addr, size );
+    return view && (view->protect & VPROT_KERNEL_WRITEWATCH);
+}
+
+
 /***********************************************************************
  *           find_view_range
  *
@@ -1526,6 +1643,7 @@ static struct file_view *alloc_view(void)
  */
 static void delete_view( struct file_view *view ) /* [in] View */
 {
+    views_write_begin();
     if (!(view->protect & VPROT_SYSTEM)) unmap_area( view->base, view->size );
     set_page_vprot( view->base, view->size, 0 );
     if (mmap_is_in_reserved_area( view->base, view->size ))
@@ -1533,6 +1651,7 @@ static void delete_view( struct file_view *view ) /* [in] View */
     wine_rb_remove( &views_tree, &view->entry );
     *(struct file_view **)view = next_free_view;
     next_free_view = view;
+    views_write_end();
 }
 
 
@@ -1571,12 +1690,14 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
         return STATUS_NO_MEMORY;
     }
 
+    views_write_begin();
     view->base    = base;
     view->size    = size;
     view->protect = vprot;
     set_page_vprot( base, size, vprot );
 
     wine_rb_put( &views_tree, view->base, &view->entry );
+    views_write_end();
     if (mmap_is_in_reserved_area( view->base, view->size ))
         free_ranges_insert_view( view );
 
@@ -1758,6 +1879,201 @@ static void update_write_watches( void *base, size_t size, size_t accessed_size
 }
 
 
+#if defined(HAVE_LINUX_USERFAULTFD_H) && defined(__NR_userfaultfd)
+
+/* Kernel write watches: the pages are write-protected through userfaultfd in asynchronous
+ * mode, so writes are resolved by the kernel without any fault reaching us, and the written
+ * pages are collected with the PAGEMAP_SCAN ioctl. Requires Linux 6.7. */
+
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+#ifndef UFFD_FEATURE_WP_UNPOPULATED
+#define UFFD_FEATURE_WP_UNPOPULATED (1 << 13)
+#endif
+#ifndef UFFD_FEATURE_WP_ASYNC
+#define UFFD_FEATURE_WP_ASYNC (1 << 15)
+#endif
+
+#ifndef PAGEMAP_SCAN
+#define PAGE_IS_WRITTEN (1 << 1)
+
+struct page_region
+{
+    ULONG64 start;
+    ULONG64 end;
+    ULONG64 categories;
+};
+
+#define PM_SCAN_WP_MATCHING   (1 << 0)
+#define PM_SCAN_CHECK_WPASYNC (1 << 1)
+
+struct pm_scan_arg
+{
+    ULONG64 size;
+    ULONG64 flags;
+    ULONG64 start;
+    ULONG64 end;
+    ULONG64 walk_end;
+    ULONG64 vec;
+    ULONG64 vec_len;
+    ULONG64 max_pages;
+    ULONG64 category_inverted;
+    ULONG64 category_mask;
+    ULONG64 category_anyof_mask;
+    ULONG64 return_mask;
+};
+
+#define PAGEMAP_SCAN _IOWR( 'f', 16, struct pm_scan_arg )
+#endif
+
+static int uffd_fd = -1;
+static int pagemap_fd = -1;
+
+/***********************************************************************
+ *           kernel_writewatch_init
+ */
+static void kernel_writewatch_init(void)
+{
+    static const ULONG64 features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+    struct uffdio_api api;
+    struct pm_scan_arg arg;
+    const char *env = getenv( "WINE_DISABLE_KERNEL_WRITEWATCH" );
+
+    if (env && atoi( env )) return;
+
+    if ((uffd_fd = syscall( __NR_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY )) == -1) return;
+    if ((pagemap_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC )) == -1) goto failed;
+
+    memset( &api, 0, sizeof(api) );
+    api.api = UFFD_API;
+    api.features = features;
+    if (ioctl( uffd_fd, UFFDIO_API, &api ) || (api.features & features) != features) goto failed;
+
+    /* check that PAGEMAP_SCAN is supported with an empty scan */
+    memset( &arg, 0, sizeof(arg) );
+    arg.size = sizeof(arg);
+    arg.start = arg.end = (ULONG_PTR)page_size;
+    arg.category_mask = arg.return_mask = PAGE_IS_WRITTEN;
+    if (ioctl( pagemap_fd, PAGEMAP_SCAN, &arg ) == -1) goto failed;
+
+    TRACE( "using kernel write watches\n" );
+    return;
+
+failed:
+    close( uffd_fd );
+    if (pagemap_fd != -1) close( pagemap_fd );
+    uffd_fd = pagemap_fd = -1;
+}
+
+static inline BOOL use_kernel_writewatch(void)
+{
+    return uffd_fd != -1;
+}
+
+/***********************************************************************
+ *           kernel_writewatch_reset
+ */
+static void kernel_writewatch_reset( void *base, SIZE_T size )
+{
+    struct uffdio_writeprotect wp;
+
+    wp.range.start = (ULONG_PTR)base;
+    wp.range.len = size;
+    wp.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_WRITEPROTECT, &wp ))
+        ERR( "failed to write-protect %p-%p, errno %d\n", base, (char *)base + size, errno );
+}
+
+/***********************************************************************
+ *           kernel_writewatch_register
+ *
+ * Register a range for write watches and mark all its pages as unwritten.
+ */
+static NTSTATUS kernel_writewatch_register( void *base, SIZE_T size )
+{
+    struct uffdio_register reg;
+
+    reg.range.start = (ULONG_PTR)base;
+    reg.range.len = size;
+    reg.mode = UFFDIO_REGISTER_MODE_WP;
+    if (ioctl( uffd_fd, UFFDIO_REGISTER, &reg ))
+    {
+        WARN( "failed to register %p-%p, errno %d\n", base, (char *)base + size, errno );
+        return errno_to_status( errno );
+    }
+    kernel_writewatch_reset( base, size );
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           kernel_get_write_watches
+ *
+ * Retrieve the addresses of the written pages, optionally resetting them.
+ */
+static void kernel_get_write_watches( char *base, SIZE_T size, void **addresses, ULONG_PTR *count, BOOL reset )
+{
+    struct page_region regions[64];
+    struct pm_scan_arg arg;
+    ULONG_PTR pos = 0;
+    char *end = base + size;
+    char *addr;
+    int i, ret;
+
+    while (base < end && pos < *count)
+    {
+        memset( &arg, 0, sizeof(arg) );
+        arg.size = sizeof(arg);
+        arg.flags = reset ? PM_SCAN_WP_MATCHING | PM_SCAN_CHECK_WPASYNC : 0;
+        arg.start = (ULONG_PTR)base;
+        arg.end = (ULONG_PTR)end;
+        arg.vec = (ULONG_PTR)regions;
+        arg.vec_len = ARRAY_SIZE(regions);
+        arg.max_pages = *count - pos;
+        arg.category_mask = arg.return_mask = PAGE_IS_WRITTEN;
+
+        if ((ret = ioctl( pagemap_fd, PAGEMAP_SCAN, &arg )) == -1)
+        {
+            ERR( "scan of %p-%p failed, errno %d\n", base, end, errno );
+            break;
+        }
+        for (i = 0; i < ret; i++)
+            for (addr = (char *)(ULONG_PTR)regions[i].start; addr < (char *)(ULONG_PTR)regions[i].end; addr += page_size)
+                addresses[pos++] = addr;
+        if ((char *)(ULONG_PTR)arg.walk_end <= base) break;
+        base = (char *)(ULONG_PTR)arg.walk_end;
+    }
+    *count = pos;
+}
+
+#else  /* HAVE_LINUX_USERFAULTFD_H */
+
+static void kernel_writewatch_init(void)
+{
+}
+
+static inline BOOL use_kernel_writewatch(void)
+{
+    return FALSE;
+}
+
+static void kernel_writewatch_reset( void *base, SIZE_T size )
+{
+}
+
+static NTSTATUS kernel_writewatch_register( void *base, SIZE_T size )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+static void kernel_get_write_watches( char *base, SIZE_T size, void **addresses, ULONG_PTR *count, BOOL reset )
+{
+    *count = 0;
+}
+
+#endif  /* HAVE_LINUX_USERFAULTFD_H */
+
+
 /***********************************************************************
  *           reset_write_watches
  *
@@ -1765,6 +2081,11 @@ static void update_write_watches( void *base, size_t size, size_t accessed_size
  */
 static void reset_write_watches( void *base, SIZE_T size )
 {
+    if (is_kernel_write_watch_range( base, size ))
+    {
+        kernel_writewatch_reset( base, size );
+        return;
+    }
     set_page_vprot_bits( base, size, VPROT_WRITEWATCH, 0 );
     mprotect_range( base, size, 0, 0 );
 }
@@ -1773,13 +2094,13 @@ static void reset_write_watches( void *base, SIZE_T size )
 /***********************************************************************
  *           unmap_extra_space
  *
- * Release the extra memory while keeping the range starting on the granularity boundary.
+ * Release the extra memory while keeping the range starting on the alignment boundary.
  */
-static inline void *unmap_extra_space( void *ptr, size_t total_size, size_t wanted_size )
+static inline void *unmap_extra_space( void *ptr, size_t total_size, size_t wanted_size, size_t align_mask )
 {
-    if ((ULONG_PTR)ptr & granularity_mask)
+    if ((ULONG_PTR)ptr & align_mask)
     {
-        size_t extra = granularity_mask + 1 - ((ULONG_PTR)ptr & granularity_mask);
+        size_t extra = align_mask + 1 - ((ULONG_PTR)ptr & align_mask);
         munmap( ptr, extra );
         ptr = (char *)ptr + extra;
         total_size -= extra;
@@ -1888,18 +2209,36 @@ static NTSTATUS map_fixed_area( void *base, size_t size, unsigned int vprot )
     return STATUS_SUCCESS;
 }
 
+/***********************************************************************
+ *           set_huge_page_hint
+ *
+ * Ask the kernel to back a range with transparent huge pages.
+ */
+static void set_huge_page_hint( void *base, size_t size )
+{
+#ifdef MADV_HUGEPAGE
+    if (madvise( base, size, MADV_HUGEPAGE ))
+        WARN( "failed to enable huge pages for %p-%p, errno %d\n", base, (char *)base + size, errno );
+#endif
+}
+
+
 /***********************************************************************
  *           map_view
  *
  * Create a view and mmap the corresponding memory area.
+ * align_mask is only used when base is NULL, 0 means allocation granularity.
  * virtual_mutex must be held by caller.
  */
 static NTSTATUS map_view( struct file_view **view_ret, void *base, size_t size,
-                          int top_down, unsigned int vprot, ULONG_PTR zero_bits )
+                          int top_down, unsigned int vprot, ULONG_PTR zero_bits, size_t align_mask )
 {
     void *ptr;
     NTSTATUS status;
 
+    if (!align_mask) align_mask = granularity_mask;
+    assert( !(align_mask & (align_mask + 1)) && align_mask >= granularity_mask );
+
     if (base)
     {
         if (is_beyond_limit( base, size, address_space_limit ))
@@ -1910,16 +2249,17 @@ static NTSTATUS map_view( struct file_view **view_ret, void *base, size_t size,
     }
     else
     {
-        size_t view_size = size + granularity_mask + 1;
+        size_t view_size = size + align_mask + 1;
+        size_t extra_size = align_mask - granularity_mask;  /* needed on top of the granularity alignment */
         struct alloc_area alloc;
 
-        alloc.size = size;
+        alloc.size = size + extra_size;
         alloc.top_down = top_down;
         alloc.limit = (void*)(get_zero_bits_mask( zero_bits ) & (UINT_PTR)user_space_limit);
 
         if (mmap_enum_reserved_areas( alloc_reserved_area_callback, &alloc, top_down ))
         {
-            ptr = alloc.result;
+            ptr = ROUND_ADDR( (char *)alloc.result + align_mask, align_mask );
             TRACE( "got mem in reserved area %p-%p\n", ptr, (char *)ptr + size );
             if (anon_mmap_fixed( ptr, size, get_unix_prot(vprot), 0 ) != ptr)
                 return STATUS_INVALID_PARAMETER;
@@ -1928,9 +2268,10 @@ static NTSTATUS map_view( struct file_view **view_ret, void *base, size_t size,
 
         if (zero_bits)
         {
-            if (!(ptr = map_free_area( address_space_start, alloc.limit, size,
+            if (!(ptr = map_free_area( address_space_start, alloc.limit, size + extra_size,
                                        top_down, get_unix_prot(vprot) )))
                 return STATUS_NO_MEMORY;
+            ptr = unmap_extra_space( ptr, size + extra_size, size, align_mask );
             TRACE( "got mem with map_free_area %p-%p\n", ptr, (char *)ptr + size );
             goto done;
         }
@@ -1947,7 +2288,7 @@ static NTSTATUS map_view( struct file_view **view_ret, void *base, size_t size,
             if (is_beyond_limit( ptr, view_size, user_space_limit )) add_reserved_area( ptr, view_size );
             else break;
         }
-        ptr = unmap_extra_space( ptr, view_size, size );
+        ptr = unmap_extra_space( ptr, view_size, size, align_mask );
     }
 done:
     status = create_view( view_ret, ptr, size, vprot );
@@ -2079,6 +2420,14 @@ static NTSTATUS decommit_pages( struct file_view *view, size_t start, size_t siz
     if (anon_mmap_fixed( (char *)view->base + start, size, PROT_NONE, 0 ) != MAP_FAILED)
     {
         set_page_vprot_bits( (char *)view->base + start, size, 0, VPROT_COMMITTED );
+        /* the new mapping is no longer registered for kernel write watches */
+        if ((view->protect & VPROT_KERNEL_WRITEWATCH) &&
+            kernel_writewatch_register( (char *)view->base + start, size ))
+        {
+            /* fall back to page faults; the other pages are reported as written once */
+            view->protect &= ~VPROT_KERNEL_WRITEWATCH;
+            set_page_vprot_bits( (char *)view->base + start, size, VPROT_WRITEWATCH, 0 );
+        }
         return STATUS_SUCCESS;
     }
     return STATUS_NO_MEMORY;
@@ -2107,7 +2456,7 @@ static NTSTATUS allocate_dos_memory( struct file_view **view, unsigned int vprot
     if (mmap_is_in_reserved_area( low_64k, dosmem_size - 0x10000 ) != 1)
     {
         addr = anon_mmap_tryfixed( low_64k, dosmem_size - 0x10000, unix_prot, 0 );
-        if (addr == MAP_FAILED) return map_view( view, NULL, dosmem_size, FALSE, vprot, 0 );
+        if (addr == MAP_FAILED) return map_view( view, NULL, dosmem_size, FALSE, vprot, 0, 0 );
     }
 
     /* now try to allocate the low 64K too */
@@ -2451,9 +2800,9 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     if ((ULONG_PTR)base != image_info->base) base = NULL;
 
     if ((char *)base >= (char *)address_space_start)  /* make sure the DOS area remains free */
-        status = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits );
+        status = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits, 0 );
 
-    if (status) status = map_view( &view, NULL, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits );
+    if (status) status = map_view( &view, NULL, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits, 0 );
     if (status) goto done;
 
     status = map_image_into_view( view, filename, unix_fd, base, image_info->header_size,
@@ -2576,7 +2925,7 @@ static NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_PTR z
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
-    res = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits );
+    res = map_view( &view, base, size, alloc_type & MEM_TOP_DOWN, vprot, zero_bits, 0 );
     if (res) goto done;
 
     TRACE( "handle=%p size=%lx offset=%x%08x\n", handle, size, offset.u.HighPart, offset.u.LowPart );
@@ -2648,6 +2997,7 @@ void virtual_init(void)
 {
     const struct preload_info **preload_info = dlsym( RTLD_DEFAULT, "wine_main_preload_info" );
     const char *preload = getenv( "WINEPRELOADRESERVE" );
+    const char *env;
     struct alloc_virtual_heap alloc_views;
     size_t size;
     int i;
@@ -2695,6 +3045,8 @@ void virtual_init(void)
     free_ranges = (void *)((char *)alloc_views.base + view_block_size);
     pages_vprot = (void *)((char *)alloc_views.base + 2 * view_block_size);
     wine_rb_init( &views_tree, compare_view );
+    kernel_writewatch_init();
+    if ((env = getenv( "WINE_THP_HINT" ))) huge_page_hint = atoi( env );
 
     free_ranges[0].base = (void *)0;
     free_ranges[0].end = (void *)~0;
@@ -3114,7 +3466,7 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR zero_bits, SI
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
     if ((status = map_view( &view, NULL, size + extra_size, FALSE,
-                            VPROT_READ | VPROT_WRITE | VPROT_COMMITTED, zero_bits )) != STATUS_SUCCESS)
+                            VPROT_READ | VPROT_WRITE | VPROT_COMMITTED, zero_bits, 0 )) != STATUS_SUCCESS)
         goto done;
 
 #ifdef VALGRIND_STACK_REGISTER
@@ -3134,12 +3486,14 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR zero_bits, SI
 
         /* shrink the first view and create a second one for the extra size */
         /* this allows the app to free the stack without freeing the thread start portion */
+        views_write_begin();
         view->size -= extra_size;
         status = create_view( &extra_view, (char *)view->base + view->size, extra_size,
                               VPROT_READ | VPROT_WRITE | VPROT_COMMITTED );
+        if (status != STATUS_SUCCESS) view->size += extra_size;
+        views_write_end();
         if (status != STATUS_SUCCESS)
         {
-            view->size += extra_size;
             delete_view( view );
             goto done;
         }
@@ -3481,9 +3835,13 @@ ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
  */
 BOOL virtual_is_valid_code_address( const void *addr, SIZE_T size )
 {
-    struct file_view *view;
+    struct file_view *view, copy;
     BOOL ret = FALSE;
     sigset_t sigset;
+    LONG seq;
+
+    if (find_view_nolock( addr, size, &copy, &seq ))
+        return copy.size && !(copy.protect & VPROT_SYSTEM);
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
     if ((view = find_view( addr, size )))
@@ -3728,7 +4086,7 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
     BOOL is_dos_memory = FALSE;
     struct file_view *view;
     sigset_t sigset;
-    SIZE_T size = *size_ptr;
+    SIZE_T size = *size_ptr, align_mask = 0;
     NTSTATUS status = STATUS_SUCCESS;
 
     TRACE("%p %p %08lx %x %08x\n", process, *ret, size, type, protect );
@@ -3795,12 +4153,23 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
     /* Compute the alloc type flags */
 
     if (!(type & (MEM_COMMIT | MEM_RESERVE | MEM_RESET)) ||
-        (type & ~(MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET)))
+        (type & ~(MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET | MEM_LARGE_PAGES)))
     {
         WARN("called with wrong alloc type flags (%08x) !\n", type);
         return STATUS_INVALID_PARAMETER;
     }
 
+    if (type & MEM_LARGE_PAGES)
+    {
+        /* large pages must be reserved and committed at once, in multiples of the large page size */
+        if ((type & (MEM_COMMIT | MEM_RESERVE)) != (MEM_COMMIT | MEM_RESERVE) ||
+            ((UINT_PTR)base & large_page_mask) || (size & large_page_mask))
+            return STATUS_INVALID_PARAMETER;
+        align_mask = large_page_mask;
+    }
+    else if (huge_page_hint && !base && size >= 16 * (large_page_mask + 1))
+        align_mask = large_page_mask;
+
     /* Reserve the memory */
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
@@ -3815,9 +4184,26 @@ NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR z
 
             if (vprot & VPROT_WRITECOPY) status = STATUS_INVALID_PAGE_PROTECTION;
             else if (is_dos_memory) status = allocate_dos_memory( &view, vprot );
-            else status = map_view( &view, base, size, type & MEM_TOP_DOWN, vprot, zero_bits );
+            else status = map_view( &view, base, size, type & MEM_TOP_DOWN, vprot, zero_bits, align_mask );
 
-            if (status == STATUS_SUCCESS) base = view->base;
+            if (status == STATUS_SUCCESS)
+            {
+                base = view->base;
+                if (align_mask) set_huge_page_hint( view->base, view->size );
+                if ((vprot & VPROT_WRITEWATCH) && use_kernel_writewatch())
+                {
+                    /* the kernel tracks the writes, so the pages don't need to be write-protected */
+                    set_page_vprot_bits( view->base, view->size, 0, VPROT_WRITEWATCH );
+                    mprotect_range( view->base, view->size, 0, 0 );
+                    if (!kernel_writewatch_register( view->base, view->size ))
+                        view->protect |= VPROT_KERNEL_WRITEWATCH;
+                    else
+                    {
+                        set_page_vprot_bits( view->base, view->size, VPROT_WRITEWATCH, 0 );
+                        mprotect_range( view->base, view->size, 0, 0 );
+                    }
+                }
+            }
         }
     }
     else if (type & MEM_RESET)
@@ -4080,15 +4466,27 @@ static int get_free_mem_state_callback( void *start, SIZE_T size, void *arg )
     return 1;
 }
 
+/* fill the view-dependent fields of the basic memory information */
+static void fill_view_basic_info( const struct file_view *view, BYTE vprot, MEMORY_BASIC_INFORMATION *info )
+{
+    info->State = (vprot & VPROT_COMMITTED) ? MEM_COMMIT : MEM_RESERVE;
+    info->Protect = (vprot & VPROT_COMMITTED) ? get_win32_prot( vprot, view->protect ) : 0;
+    info->AllocationProtect = get_win32_prot( view->protect, view->protect );
+    if (view->protect & SEC_IMAGE) info->Type = MEM_IMAGE;
+    else if (view->protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT)) info->Type = MEM_MAPPED;
+    else info->Type = MEM_PRIVATE;
+}
+
 /* get basic information about a memory block */
 static NTSTATUS get_basic_memory_info( HANDLE process, LPCVOID addr,
                                        MEMORY_BASIC_INFORMATION *info,
                                        SIZE_T len, SIZE_T *res_len )
 {
-    struct file_view *view;
+    struct file_view *view, copy;
     char *base, *alloc_base = 0, *alloc_end = working_set_limit;
     struct wine_rb_entry *ptr;
     sigset_t sigset;
+    LONG seq;
 
     if (len < sizeof(MEMORY_BASIC_INFORMATION))
         return STATUS_INFO_LENGTH_MISMATCH;
@@ -4126,6 +4524,25 @@ static NTSTATUS get_basic_memory_info( HANDLE process, LPCVOID addr,
 
     if (is_beyond_limit( base, 1, working_set_limit )) return STATUS_INVALID_PARAMETER;
 
+    /* Try without the lock first; SEC_RESERVE views need a server call to get the committed size */
+
+    if (find_view_nolock( base, 1, &copy, &seq ) && copy.size && !(copy.protect & SEC_RESERVE))
+    {
+        BYTE vprot;
+        SIZE_T size = get_vprot_range_size( base, (char *)copy.base + copy.size - base,
+                                            ~VPROT_WRITEWATCH, &vprot );
+
+        if (!views_read_retry( seq ))
+        {
+            info->AllocationBase = copy.base;
+            info->BaseAddress    = base;
+            info->RegionSize     = size;
+            fill_view_basic_info( &copy, vprot, info );
+            if (res_len) *res_len = sizeof(*info);
+            return STATUS_SUCCESS;
+        }
+    }
+
     /* Find the view containing the address */
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
@@ -4186,12 +4603,7 @@ static NTSTATUS get_basic_memory_info( HANDLE process, LPCVOID addr,
         BYTE vprot;
 
         info->RegionSize = get_committed_size( view, base, &vprot, ~VPROT_WRITEWATCH );
-        info->State = (vprot & VPROT_COMMITTED) ? MEM_COMMIT : MEM_RESERVE;
-        info->Protect = (vprot & VPROT_COMMITTED) ? get_win32_prot( vprot, view->protect ) : 0;
-        info->AllocationProtect = get_win32_prot( view->protect, view->protect );
-        if (view->protect & SEC_IMAGE) info->Type = MEM_IMAGE;
-        else if (view->protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT)) info->Type = MEM_MAPPED;
-        else info->Type = MEM_PRIVATE;
+        fill_view_basic_info( view, vprot, info );
     }
     server_leave_uninterrupted_section( &virtual_mutex, &sigset );
 
@@ -4759,7 +5171,13 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
-    if (is_write_watch_range( base, size ))
+    if (is_kernel_write_watch_range( base, size ))
+    {
+        /* the scan write-protects the written pages again atomically when resetting */
+        kernel_get_write_watches( base, size, addresses, count, flags & WRITE_WATCH_FLAG_RESET );
+        *granularity = page_size;
+    }
+    else if (is_write_watch_range( base, size ))
     {
         ULONG_PTR pos = 0;
         char *addr = base;
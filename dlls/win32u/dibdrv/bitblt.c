@@ -23,6 +23,8 @@
 #endif
 
 #include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -585,17 +587,178 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/* Large operations can optionally be split into bands of rows processed by worker threads,
+ * enabled by setting WINE_DIB_THREADS to the number of threads to use. Each destination row
+ * belongs to exactly one band, so the result is identical to the one of the serial code.
+ * The workers have no TEB and can't handle faults, so only private copies of the bits
+ * are split; application DIB memory is always processed on the calling thread. */
+
+#define MIN_BAND_PIXELS (512 * 512)
+#define MIN_BAND_ROWS   16
+#define MAX_BANDS       16
+
+struct band_job
+{
+    void (*func)( void *ctx, int band );
+    void *ctx;
+    int   count;    /* number of bands */
+    int   next;     /* next band to process */
+    int   pending;  /* number of bands not finished yet */
+};
+
+static pthread_once_t band_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t band_job_mutex = PTHREAD_MUTEX_INITIALIZER;  /* only one job at a time */
+static pthread_mutex_t band_mutex = PTHREAD_MUTEX_INITIALIZER;      /* protects the current job */
+static pthread_cond_t band_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done_cond = PTHREAD_COND_INITIALIZER;
+static struct band_job *band_job;
+static unsigned int band_threads;
+
+/* process bands of the current job, called with band_mutex held */
+static void process_bands( struct band_job *job )
+{
+    int band;
+
+    while (job->next < job->count)
+    {
+        band = job->next++;
+        pthread_mutex_unlock( &band_mutex );
+        job->func( job->ctx, band );
+        pthread_mutex_lock( &band_mutex );
+        if (!--job->pending) pthread_cond_broadcast( &band_done_cond );
+    }
+}
+
+static void *band_thread( void *arg )
+{
+    pthread_mutex_lock( &band_mutex );
+    for (;;)
+    {
+        if (band_job) process_bands( band_job );
+        pthread_cond_wait( &band_start_cond, &band_mutex );
+    }
+    return NULL;
+}
+
+static void init_band_threads(void)
+{
+    const char *env = getenv( "WINE_DIB_THREADS" );
+    unsigned int i, count = env ? min( atoi( env ), MAX_BANDS - 1 ) : 0;
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    for (i = 0; i < count; i++)
+    {
+        if (pthread_create( &thread, &attr, band_thread, NULL )) break;
+        band_threads++;
+    }
+    pthread_attr_destroy( &attr );
+    if (band_threads) TRACE( "using %u threads\n", band_threads );
+}
+
+/* return the number of bands to split an operation into, or 0 to use the serial code */
+static int get_band_count( const dib_info *dst, const dib_info *src, int width, int height )
+{
+    int count;
+
+    if (!dst->bits.is_copy || (src && !src->bits.is_copy)) return 0;
+    pthread_once( &band_once, init_band_threads );
+    if (!band_threads || (LONGLONG)width * height < MIN_BAND_PIXELS) return 0;
+    count = min( band_threads + 1, height / MIN_BAND_ROWS );
+    return count > 1 ? count : 0;
+}
+
+/* run func on all bands, using the worker threads when they aren't busy with another job */
+static void run_bands( void (*func)( void *ctx, int band ), void *ctx, int count )
+{
+    struct band_job job;
+    int band;
+
+    if (pthread_mutex_trylock( &band_job_mutex ))
+    {
+        for (band = 0; band < count; band++) func( ctx, band );
+        return;
+    }
+
+    job.func    = func;
+    job.ctx     = ctx;
+    job.count   = count;
+    job.next    = 0;
+    job.pending = count;
+
+    pthread_mutex_lock( &band_mutex );
+    band_job = &job;
+    pthread_cond_broadcast( &band_start_cond );
+    process_bands( &job );
+    while (job.pending) pthread_cond_wait( &band_done_cond, &band_mutex );
+    band_job = NULL;
+    pthread_mutex_unlock( &band_mutex );
+
+    pthread_mutex_unlock( &band_job_mutex );
+}
+
+/* intersect a rectangle with the rows of a band */
+static BOOL get_band_rect( const RECT *rect, int top, int bottom, int count, int band, RECT *ret )
+{
+    *ret = *rect;
+    ret->top    = max( rect->top, top + (bottom - top) * band / count );
+    ret->bottom = min( rect->bottom, top + (bottom - top) * (band + 1) / count );
+    return ret->top < ret->bottom;
+}
+
+struct rect_bands
+{
+    dib_info                    *dib;
+    const struct clipped_rects  *clipped_rects;
+    const RECT                  *bounds;
+    int                          count;
+    /* blend_rect */
+    const dib_info              *src;
+    POINT                        offset;
+    BLENDFUNCTION                blend;
+    /* gradient_rect */
+    const TRIVERTEX             *vert;
+    int                          mode;
+    BOOL                         ret;
+};
+
+static void blend_rect_band( void *ctx, int band )
+{
+    struct rect_bands *bands = ctx;
+    RECT rect;
+    int i;
+
+    for (i = 0; i < bands->clipped_rects->count; i++)
+        if (get_band_rect( &bands->clipped_rects->rects[i], bands->bounds->top, bands->bounds->bottom,
+                           bands->count, band, &rect ))
+            bands->dib->funcs->blend_rects( bands->dib, 1, &rect, bands->src, &bands->offset, bands->blend );
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
     POINT offset;
     struct clipped_rects clipped_rects;
+    struct rect_bands bands;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
 
     offset.x = src_rect->left - dst_rect->left;
     offset.y = src_rect->top  - dst_rect->top;
-    dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
+
+    if ((bands.count = get_band_count( dst, src, dst_rect->right - dst_rect->left, dst_rect->bottom - dst_rect->top )))
+    {
+        bands.dib           = dst;
+        bands.clipped_rects = &clipped_rects;
+        bands.bounds        = dst_rect;
+        bands.src           = src;
+        bands.offset        = offset;
+        bands.blend         = blend;
+        run_bands( blend_rect_band, &bands, bands.count );
+    }
+    else dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
 
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -680,14 +843,42 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
+static void gradient_rect_band( void *ctx, int band )
+{
+    struct rect_bands *bands = ctx;
+    RECT rect;
+    int i;
+
+    for (i = 0; i < bands->clipped_rects->count; i++)
+        if (get_band_rect( &bands->clipped_rects->rects[i], bands->bounds->top, bands->bounds->bottom,
+                           bands->count, band, &rect ) &&
+            !bands->dib->funcs->gradient_rect( bands->dib, &rect, bands->vert, bands->mode ))
+        {
+            bands->ret = FALSE;  /* the failure doesn't depend on the rectangle, all bands fail */
+            break;
+        }
+}
+
 static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
 {
     int i;
     struct clipped_rects clipped_rects;
+    struct rect_bands bands;
     BOOL ret = TRUE;
 
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
-    for (i = 0; i < clipped_rects.count; i++)
+    if ((bands.count = get_band_count( dib, NULL, bounds->right - bounds->left, bounds->bottom - bounds->top )))
+    {
+        bands.dib           = dib;
+        bands.clipped_rects = &clipped_rects;
+        bands.bounds        = bounds;
+        bands.vert          = v;
+        bands.mode          = mode;
+        bands.ret           = TRUE;
+        run_bands( gradient_rect_band, &bands, bands.count );
+        ret = bands.ret;
+    }
+    else for (i = 0; i < clipped_rects.count; i++)
     {
         if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
     }
@@ -1198,27 +1389,151 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
-DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                          const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                          INT mode )
+struct stretch_rows
+{
+    dib_info                     *dst_dib;
+    const dib_info               *src_dib;
+    const struct stretch_params  *h_params;
+    const struct stretch_params  *v_params;
+    int                           mode;
+    int                           width;
+    BOOL                          vstretch;
+    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
+                    const dib_info *src_dib, const POINT *src_start,
+                    const struct stretch_params *params, int mode, BOOL keep_dst);
+    /* start of each band, when splitting the rows into bands */
+    struct
+    {
+        POINT dst_start, src_start;
+        int err;
+        unsigned int row;
+    } bands[MAX_BANDS + 1];
+};
+
+static void stretch_rows( const struct stretch_rows *rows, POINT dst_start, POINT src_start,
+                          int err, unsigned int length )
+{
+    const struct stretch_params *v_params = rows->v_params;
+    int mode = rows->mode;
+
+    if (rows->vstretch)
+    {
+        BOOL need_row = TRUE;
+        RECT last_row, this_row;
+        last_row.left = 0;
+        last_row.right = rows->width;
+
+        while (length--)
+        {
+            if (need_row)
+            {
+                rows->row_fn( rows->dst_dib, &dst_start, rows->src_dib, &src_start, rows->h_params, mode, FALSE );
+                need_row = FALSE;
+            }
+            else
+            {
+                last_row.top = dst_start.y - v_params->dst_inc;
+                last_row.bottom = last_row.top + 1;
+                this_row = last_row;
+                OffsetRect( &this_row, 0, v_params->dst_inc );
+                copy_rect( rows->dst_dib, &this_row, rows->dst_dib, &last_row, NULL, R2_COPYPEN );
+            }
+
+            if (err > 0)
+            {
+                src_start.y += v_params->src_inc;
+                need_row = TRUE;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
+        }
+    }
+    else
+    {
+        int merged_rows = 0;
+
+        while (length--)
+        {
+            if (mode != STRETCH_DELETESCANS || !merged_rows)
+                rows->row_fn( rows->dst_dib, &dst_start, rows->src_dib, &src_start, rows->h_params,
+                              mode, merged_rows != 0 );
+            merged_rows++;
+
+            if (err > 0)
+            {
+                dst_start.y += v_params->dst_inc;
+                merged_rows = 0;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
+        }
+    }
+}
+
+/* compute the starting state of each band, a band can only start on a new destination row */
+static int get_stretch_bands( struct stretch_rows *rows, POINT dst_start, POINT src_start, int err, int count )
+{
+    const struct stretch_params *v_params = rows->v_params;
+    unsigned int row, length = v_params->length;
+    BOOL new_row = TRUE;
+    int band = 0;
+
+    for (row = 0; row < length; row++)
+    {
+        if (new_row && row >= (ULONGLONG)length * band / count)
+        {
+            rows->bands[band].dst_start = dst_start;
+            rows->bands[band].src_start = src_start;
+            rows->bands[band].err = err;
+            rows->bands[band].row = row;
+            if (++band == count) break;
+        }
+        new_row = rows->vstretch || err > 0;
+        if (err > 0)
+        {
+            if (rows->vstretch) src_start.y += v_params->src_inc;
+            else dst_start.y += v_params->dst_inc;
+            err += v_params->err_add_1;
+        }
+        else err += v_params->err_add_2;
+        if (rows->vstretch) dst_start.y += v_params->dst_inc;
+        else src_start.y += v_params->src_inc;
+    }
+    rows->bands[band].row = length;
+    return band;
+}
+
+static void stretch_rows_band( void *ctx, int band )
+{
+    const struct stretch_rows *rows = ctx;
+
+    stretch_rows( rows, rows->bands[band].dst_start, rows->bands[band].src_start, rows->bands[band].err,
+                  rows->bands[band + 1].row - rows->bands[band].row );
+}
+
+DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, const struct gdi_image_bits *src_bits,
+                          struct bitblt_coords *src, const BITMAPINFO *dst_info,
+                          const struct gdi_image_bits *dst_bits, struct bitblt_coords *dst, INT mode )
 {
     dib_info src_dib, dst_dib;
     POINT dst_start, src_start, dst_end, src_end;
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_rows rows;
+    int count;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
           src->x, src->y, src->width, src->height, wine_dbgstr_rect(&src->visrect));
 
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
-    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits->ptr );
+    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits->ptr );
+    src_dib.bits.is_copy = src_bits->is_copy;
+    dst_dib.bits.is_copy = dst_bits->is_copy;
 
     if (mode == HALFTONE)
     {
@@ -1251,64 +1566,20 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
-    {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
-
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                OffsetRect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
-    }
+    rows.dst_dib  = &dst_dib;
+    rows.src_dib  = &src_dib;
+    rows.h_params = &h_params;
+    rows.v_params = &v_params;
+    rows.mode     = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    rows.width    = dst->visrect.right - dst->visrect.left;
+    rows.vstretch = vstretch;
+    rows.row_fn   = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+
+    if ((count = get_band_count( &dst_dib, &src_dib, rows.width, dst->visrect.bottom - dst->visrect.top )) &&
+        (count = get_stretch_bands( &rows, dst_start, src_start, v_params.err_start, count )) > 1)
+        run_bands( stretch_rows_band, &rows, count );
     else
-    {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
-    }
+        stretch_rows( &rows, dst_start, src_start, v_params.err_start, v_params.length );
 
 done:
     /* update coordinates, the destination rectangle is always stored at 0,0 */
@@ -1319,20 +1590,23 @@ done:
     return ERROR_SUCCESS;
 }
 
-DWORD blend_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                        const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
+DWORD blend_bitmapinfo( const BITMAPINFO *src_info, const struct gdi_image_bits *src_bits,
+                        struct bitblt_coords *src, const BITMAPINFO *dst_info,
+                        const struct gdi_image_bits *dst_bits, struct bitblt_coords *dst,
                         BLENDFUNCTION blend )
 {
     dib_info src_dib, dst_dib;
 
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
-    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits->ptr );
+    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits->ptr );
+    src_dib.bits.is_copy = src_bits->is_copy;
+    dst_dib.bits.is_copy = dst_bits->is_copy;
 
     return blend_rect( &dst_dib, &dst->visrect, &src_dib, &src->visrect, NULL, blend );
 }
 
-DWORD gradient_bitmapinfo( const BITMAPINFO *info, void *bits, TRIVERTEX *vert_array, ULONG nvert,
-                           void *grad_array, ULONG ngrad, ULONG mode, const POINT *dev_pts, HRGN rgn )
+DWORD gradient_bitmapinfo( const BITMAPINFO *info, const struct gdi_image_bits *bits, TRIVERTEX *vert_array,
+                           ULONG nvert, void *grad_array, ULONG ngrad, ULONG mode, const POINT *dev_pts, HRGN rgn )
 {
     dib_info dib;
     const GRADIENT_TRIANGLE *tri = grad_array;
@@ -1343,7 +1617,8 @@ DWORD gradient_bitmapinfo( const BITMAPINFO *info, void *bits, TRIVERTEX *vert_a
     RECT rc;
     DWORD ret = ERROR_SUCCESS;
 
-    init_dib_info_from_bitmapinfo( &dib, info, bits );
+    init_dib_info_from_bitmapinfo( &dib, info, bits->ptr );
+    dib.bits.is_copy = bits->is_copy;
 
     switch (mode)
     {
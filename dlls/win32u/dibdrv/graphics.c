@@ -47,18 +47,46 @@ enum glyph_type
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
 
+/* Glyphs are packed into blocks that are only freed with the font. */
+#define GLYPH_BLOCK_SIZE       0x4000
+
+struct glyph_block
+{
+    struct glyph_block *next;
+    SIZE_T              size;
+    SIZE_T              used;
+};
+
 struct cached_font
 {
-    struct list           entry;
+    struct list           entry;       /* entry in the LRU list */
+    struct list           hash_entry;  /* entry in the hash bucket */
     LONG                  ref;
     DWORD                 hash;
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    pthread_mutex_t       block_lock;
+    struct glyph_block   *blocks;
+    LONG                  size;
+    LONG                  glyph_count;
+    LONG                  hits;
+    LONG                  misses;
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
+/* Unused fonts are kept around until there are more than FONT_CACHE_MAX_UNUSED
+ * of them, or until the glyphs of all the cached fonts use more than
+ * FONT_CACHE_MAX_SIZE bytes. The least recently used ones go first. Fonts that
+ * are still referenced are never freed, since glyphs are read without locking. */
+#define FONT_CACHE_BUCKETS     64
+#define FONT_CACHE_MAX_UNUSED  32
+#define FONT_CACHE_MAX_SIZE    (8 * 1024 * 1024)
+
 static struct list font_cache = LIST_INIT( font_cache );
+static struct list font_cache_buckets[FONT_CACHE_BUCKETS];
+static unsigned int font_cache_count;
+static LONG font_cache_size;
 
 static pthread_mutex_t font_cache_lock = PTHREAD_MUTEX_INITIALIZER;
 
@@ -551,10 +579,56 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static void free_cached_font( struct cached_font *font )
+{
+    struct glyph_block *block, *next;
+    UINT i, j;
+
+    TRACE( "%p %d %s: %d glyphs, %d bytes, %d hits, %d misses\n", font, font->lf.lfHeight,
+           debugstr_w(font->lf.lfFaceName), font->glyph_count, font->size, font->hits, font->misses );
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+            free( font->glyphs[i][j] );
+    for (block = font->blocks; block; block = next)
+    {
+        next = block->next;
+        free( block );
+    }
+    InterlockedExchangeAdd( &font_cache_size, -font->size );
+    pthread_mutex_destroy( &font->block_lock );
+    list_remove( &font->entry );
+    list_remove( &font->hash_entry );
+    font_cache_count--;
+    free( font );
+}
+
+/* Free the least recently used fonts that are no longer referenced, if the
+ * cache is over its limits. Must be called with the font cache lock held. */
+static void trim_font_cache(void)
+{
+    struct cached_font *font, *next;
+    unsigned int unused = 0;
+
+    LIST_FOR_EACH_ENTRY( font, &font_cache, struct cached_font, entry )
+        if (!font->ref) unused++;
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV( font, next, &font_cache, struct cached_font, entry )
+    {
+        if (unused <= FONT_CACHE_MAX_UNUSED && font_cache_size <= FONT_CACHE_MAX_SIZE) break;
+        if (font->ref) continue;
+        free_cached_font( font );
+        unused--;
+    }
+
+    TRACE( "%u fonts, %u unused, %d bytes\n", font_cache_count, unused, font_cache_size );
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
-    struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    struct cached_font font, *ptr;
+    struct list *bucket;
+    UINT i;
 
     NtGdiExtGetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -570,7 +644,11 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     font.hash = font_cache_hash( &font );
 
     pthread_mutex_lock( &font_cache_lock );
-    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
+    if (!font_cache_buckets[0].next)
+        for (i = 0; i < FONT_CACHE_BUCKETS; i++) list_init( &font_cache_buckets[i] );
+
+    bucket = &font_cache_buckets[font.hash % FONT_CACHE_BUCKETS];
+    LIST_FOR_EACH_ENTRY( ptr, bucket, struct cached_font, hash_entry )
     {
         if (!font_cache_cmp( &font, ptr ))
         {
@@ -578,29 +656,9 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
             list_remove( &ptr->entry );
             goto done;
         }
-        if (!ptr->ref)
-        {
-            i++;
-            last_unused = ptr;
-        }
     }
 
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
-    {
-        ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    free( ptr->glyphs[i][j][k] );
-                free( ptr->glyphs[i][j] );
-            }
-        }
-        list_remove( &ptr->entry );
-    }
-    else if (!(ptr = malloc( sizeof(*ptr) )))
+    if (!(ptr = malloc( sizeof(*ptr) )))
     {
         pthread_mutex_unlock( &font_cache_lock );
         return NULL;
@@ -608,7 +666,13 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     *ptr = font;
     ptr->ref = 1;
+    pthread_mutex_init( &ptr->block_lock, NULL );
+    ptr->blocks = NULL;
+    ptr->size = ptr->glyph_count = ptr->hits = ptr->misses = 0;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
+    list_add_head( bucket, &ptr->hash_entry );
+    font_cache_count++;
+    trim_font_cache();
 done:
     list_add_head( &font_cache, &ptr->entry );
     pthread_mutex_unlock( &font_cache_lock );
@@ -621,6 +685,53 @@ void release_cached_font( struct cached_font *font )
     if (font) InterlockedDecrement( &font->ref );
 }
 
+static void add_cached_font_size( struct cached_font *font, LONG size )
+{
+    InterlockedExchangeAdd( &font->size, size );
+    InterlockedExchangeAdd( &font_cache_size, size );
+}
+
+/* Allocate space for a glyph in the font's glyph blocks. Glyphs that don't
+ * fit in a block get a block of their own. */
+static struct cached_glyph *alloc_cached_glyph( struct cached_font *font, DWORD size )
+{
+    struct glyph_block *block;
+    struct cached_glyph *glyph;
+    SIZE_T needed = FIELD_OFFSET( struct cached_glyph, bits[size] );
+
+    needed = (needed + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    pthread_mutex_lock( &font->block_lock );
+    if (!(block = font->blocks) || block->size - block->used < needed)
+    {
+        SIZE_T block_size = max( GLYPH_BLOCK_SIZE, needed );
+
+        if (!(block = malloc( sizeof(*block) + block_size )))
+        {
+            pthread_mutex_unlock( &font->block_lock );
+            return NULL;
+        }
+        block->size = block_size;
+        block->used = 0;
+        /* keep filling the current block if this glyph is a large one */
+        if (font->blocks && needed > GLYPH_BLOCK_SIZE / 4)
+        {
+            block->next = font->blocks->next;
+            font->blocks->next = block;
+        }
+        else
+        {
+            block->next = font->blocks;
+            font->blocks = block;
+        }
+        add_cached_font_size( font, sizeof(*block) + block_size );
+    }
+    glyph = (struct cached_glyph *)((BYTE *)(block + 1) + block->used);
+    block->used += needed;
+    pthread_mutex_unlock( &font->block_lock );
+    return glyph;
+}
+
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
                                               struct cached_glyph *glyph )
 {
@@ -629,23 +740,22 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
     UINT page = index / GLYPH_CACHE_PAGE_SIZE;
     UINT entry = index % GLYPH_CACHE_PAGE_SIZE;
 
+    /* glyphs that lose a race stay in the glyph block until the font is freed */
     if (!font->glyphs[type][page])
     {
         struct cached_glyph **ptr;
 
         ptr = calloc( 1, GLYPH_CACHE_PAGE_SIZE * sizeof(*ptr) );
-        if (!ptr)
-        {
-            free( glyph );
-            return NULL;
-        }
+        if (!ptr) return NULL;
         if (InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page], ptr, NULL ))
             free( ptr );
+        else
+            add_cached_font_size( font, GLYPH_CACHE_PAGE_SIZE * sizeof(*ptr) );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
-    else free( glyph );
-    return ret;
+    if (ret) return ret;
+    InterlockedIncrement( &font->glyph_count );
+    return glyph;
 }
 
 static struct cached_glyph *get_cached_glyph( struct cached_font *font, UINT index, UINT flags )
@@ -769,7 +879,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     bit_count = get_glyph_depth( font->aa_flags );
     stride = get_dib_stride( metrics.gmBlackBoxX, bit_count );
     size = metrics.gmBlackBoxY * stride;
-    glyph = malloc( FIELD_OFFSET( struct cached_glyph, bits[size] ));
+    glyph = alloc_cached_glyph( font, size );
     if (!glyph) return NULL;
     if (!size) goto done;  /* empty glyph */
 
@@ -777,11 +887,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
     ret = NtGdiGetGlyphOutline( dc->hSelf, index, ggo_flags, &metrics, size, glyph->bits,
                                 &identity, FALSE );
-    if (ret == GDI_ERROR)
-    {
-        free( glyph );
-        return NULL;
-    }
+    if (ret == GDI_ERROR) return NULL;
     assert( ret <= size );
     if (font->aa_flags == GGO_BITMAP)
     {
@@ -811,7 +917,7 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
                            UINT flags, const WCHAR *str, UINT count, const INT *dx,
                            const struct clipped_rects *clipped_rects, RECT *bounds )
 {
-    UINT i;
+    UINT i, misses = 0;
     struct cached_glyph *glyph;
     dib_info glyph_dib;
     DWORD text_color;
@@ -832,8 +938,11 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
 
     for (i = 0; i < count; i++)
     {
-        if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
-            !(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        if (!(glyph = get_cached_glyph( font, str[i], flags )))
+        {
+            misses++;
+            if (!(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        }
 
         glyph_dib.width       = glyph->metrics.gmBlackBoxX;
         glyph_dib.height      = glyph->metrics.gmBlackBoxY;
@@ -860,6 +969,9 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
             y += glyph->metrics.gmCellIncY;
         }
     }
+
+    InterlockedExchangeAdd( &font->hits, count - misses );
+    InterlockedExchangeAdd( &font->misses, misses );
 }
 
 BOOL render_aa_text_bitmapinfo( DC *dc, BITMAPINFO *info, struct gdi_image_bits *bits,
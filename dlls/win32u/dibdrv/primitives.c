@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -4682,10 +4685,122 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef __SSE2__
+
+/* divide 16-bit lanes holding values up to 255 * 255 + 127 by 255, with the same result as the C division */
+static inline __m128i div255_epu16( __m128i val )
+{
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( val, _mm_set1_epi16( 1 )), _mm_srli_epi16( val, 8 )), 8 );
+}
+
+/* scale 16-bit lanes holding channels by 16-bit lanes holding alphas, with rounding */
+static inline __m128i scale_epu16( __m128i val, __m128i alpha )
+{
+    return div255_epu16( _mm_add_epi16( _mm_mullo_epi16( val, alpha ), _mm_set1_epi16( 127 )));
+}
+
+/* 255 minus the alpha of each pixel, in all four channel lanes */
+static inline __m128i inv_alpha_epu16( __m128i val )
+{
+    val = _mm_shufflehi_epi16( _mm_shufflelo_epi16( val, 0xff ), 0xff );
+    return _mm_sub_epi16( _mm_set1_epi16( 255 ), val );
+}
+
+/* blend_argb_alpha() on four pixels at a time; returns the number of pixels processed */
+static int blend_argb_row_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16( 255 ), const_alpha = _mm_set1_epi16( alpha );
+    __m128i s, d, s_lo, s_hi, d_lo, d_hi;
+    int i, x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        s_lo = _mm_unpacklo_epi8( s, zero );
+        s_hi = _mm_unpackhi_epi8( s, zero );
+        if (alpha != 255)
+        {
+            s_lo = scale_epu16( s_lo, const_alpha );
+            s_hi = scale_epu16( s_hi, const_alpha );
+        }
+        d_lo = _mm_add_epi16( s_lo, scale_epu16( _mm_unpacklo_epi8( d, zero ), inv_alpha_epu16( s_lo )));
+        d_hi = _mm_add_epi16( s_hi, scale_epu16( _mm_unpackhi_epi8( d, zero ), inv_alpha_epu16( s_hi )));
+        /* channels above their alpha carry into the next channel, let the C code handle that */
+        if (_mm_movemask_epi8( _mm_or_si128( _mm_cmpgt_epi16( d_lo, max ), _mm_cmpgt_epi16( d_hi, max ))))
+        {
+            for (i = x; i < x + 4; i++) dst[i] = blend_argb_alpha( dst[i], src[i], alpha );
+            continue;
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( d_lo, d_hi ));
+    }
+    return x;
+}
+
+/* blend_argb_constant_alpha() on four pixels at a time; returns the number of pixels processed */
+static int blend_argb_constant_alpha_row_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha,
+                                               DWORD src_mask )
+{
+    const __m128i zero = _mm_setzero_si128(), mask = _mm_set1_epi32( src_mask );
+    const __m128i src_alpha = _mm_set1_epi16( alpha ), dst_alpha = _mm_set1_epi16( 255 - alpha );
+    const __m128i round = _mm_set1_epi16( 127 );
+    __m128i s, d, lo, hi;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), mask );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), src_alpha ),
+                            _mm_mullo_epi16( _mm_unpacklo_epi8( d, zero ), dst_alpha ));
+        hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), src_alpha ),
+                            _mm_mullo_epi16( _mm_unpackhi_epi8( d, zero ), dst_alpha ));
+        lo = div255_epu16( _mm_add_epi16( lo, round ));
+        hi = div255_epu16( _mm_add_epi16( hi, round ));
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ));
+    }
+    return x;
+}
+
+#endif  /* __SSE2__ */
+
+static void blend_argb_row( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    x = blend_argb_row_sse2( dst, src, len, alpha );
+#endif
+    if (alpha == 255)
+        for (; x < len; x++) dst[x] = blend_argb( dst[x], src[x] );
+    else
+        for (; x < len; x++) dst[x] = blend_argb_alpha( dst[x], src[x], alpha );
+}
+
+static void blend_argb_constant_alpha_row( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    x = blend_argb_constant_alpha_row_sse2( dst, src, len, alpha, 0 );
+#endif
+    for (; x < len; x++) dst[x] = blend_argb_constant_alpha( dst[x], src[x], alpha );
+}
+
+static void blend_argb_no_src_alpha_row( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    x = blend_argb_constant_alpha_row_sse2( dst, src, len, alpha, 0xff000000 );
+#endif
+    for (; x < len; x++) dst[x] = blend_argb_no_src_alpha( dst[x], src[x], alpha );
+}
+
 static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
                              const dib_info *src, const POINT *offset, BLENDFUNCTION blend)
 {
-    int i, x, y;
+    int i, y;
 
     for (i = 0; i < num; i++, rc++)
     {
@@ -4693,24 +4808,14 @@ static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
         DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
 
         if (blend.AlphaFormat & AC_SRC_ALPHA)
-        {
-            if (blend.SourceConstantAlpha == 255)
-                for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
-            else
-                for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
-        }
+            for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+                blend_argb_row( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha );
         else if (src->compression == BI_RGB)
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
-                    dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                blend_argb_constant_alpha_row( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha );
         else
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
-                    dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                blend_argb_no_src_alpha_row( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha );
     }
 }
 
@@ -6133,18 +6238,34 @@ static inline DWORD aa_rgb( BYTE r_dst, BYTE g_dst, BYTE b_dst, DWORD text, cons
             aa_color( r_dst, text >> 16, range->r_min, range->r_max ) << 16);
 }
 
+/* return the position of the next glyph pixel that needs drawing, i.e. with an intensity above 1 */
+static inline int next_glyph_pixel( const BYTE *glyph_ptr, int x, int len )
+{
+#ifdef __SSE2__
+    const __m128i one = _mm_set1_epi8( 1 ), zero = _mm_setzero_si128();
+    __m128i val;
+
+    for (; x + 16 <= len; x += 16)
+    {
+        val = _mm_subs_epu8( _mm_loadu_si128( (const __m128i *)(glyph_ptr + x) ), one );
+        if (_mm_movemask_epi8( _mm_cmpeq_epi8( val, zero )) != 0xffff) break;
+    }
+#endif
+    while (x < len && glyph_ptr[x] <= 1) x++;
+    return x;
+}
+
 static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_info *glyph,
                              const POINT *origin, DWORD text_pixel, const struct intensity_range *ranges )
 {
     DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, width = rect->right - rect->left;
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        for (x = next_glyph_pixel( glyph_ptr, 0, width ); x < width; x = next_glyph_pixel( glyph_ptr, x + 1, width ))
         {
-            if (glyph_ptr[x] <= 1) continue;
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
             dst_ptr[x] = aa_rgb( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x], text_pixel, ranges + glyph_ptr[x] );
         }
@@ -6158,7 +6279,7 @@ static void draw_glyph_32( const dib_info *dib, const RECT *rect, const dib_info
 {
     DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, width = rect->right - rect->left;
     DWORD text, val;
 
     text = get_field( text_pixel, dib->red_shift,   dib->red_len ) << 16 |
@@ -6167,9 +6288,8 @@ static void draw_glyph_32( const dib_info *dib, const RECT *rect, const dib_info
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        for (x = next_glyph_pixel( glyph_ptr, 0, width ); x < width; x = next_glyph_pixel( glyph_ptr, x + 1, width ))
         {
-            if (glyph_ptr[x] <= 1) continue;
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
             val = aa_rgb( get_field(dst_ptr[x], dib->red_shift,   dib->red_len),
                           get_field(dst_ptr[x], dib->green_shift, dib->green_len),
@@ -6187,14 +6307,13 @@ static void draw_glyph_24( const dib_info *dib, const RECT *rect, const dib_info
 {
     BYTE *dst_ptr = get_pixel_ptr_24( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, width = rect->right - rect->left;
     DWORD val;
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        for (x = next_glyph_pixel( glyph_ptr, 0, width ); x < width; x = next_glyph_pixel( glyph_ptr, x + 1, width ))
         {
-            if (glyph_ptr[x] <= 1) continue;
             if (glyph_ptr[x] >= 16)
                 val = text_pixel;
             else
@@ -6214,7 +6333,7 @@ static void draw_glyph_555( const dib_info *dib, const RECT *rect, const dib_inf
 {
     WORD *dst_ptr = get_pixel_ptr_16( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, width = rect->right - rect->left;
     DWORD text, val;
 
     text = ((text_pixel << 9) & 0xf80000) | ((text_pixel << 4) & 0x070000) |
@@ -6223,9 +6342,8 @@ static void draw_glyph_555( const dib_info *dib, const RECT *rect, const dib_inf
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        for (x = next_glyph_pixel( glyph_ptr, 0, width ); x < width; x = next_glyph_pixel( glyph_ptr, x + 1, width ))
         {
-            if (glyph_ptr[x] <= 1) continue;
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
             val = aa_rgb( ((dst_ptr[x] >> 7) & 0xf8) | ((dst_ptr[x] >> 12) & 0x07),
                           ((dst_ptr[x] >> 2) & 0xf8) | ((dst_ptr[x] >>  7) & 0x07),
@@ -6243,7 +6361,7 @@ static void draw_glyph_16( const dib_info *dib, const RECT *rect, const dib_info
 {
     WORD *dst_ptr = get_pixel_ptr_16( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int x, y, width = rect->right - rect->left;
     DWORD text, val;
 
     text = get_field( text_pixel, dib->red_shift,   dib->red_len ) << 16 |
@@ -6252,9 +6370,8 @@ static void draw_glyph_16( const dib_info *dib, const RECT *rect, const dib_info
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        for (x = next_glyph_pixel( glyph_ptr, 0, width ); x < width; x = next_glyph_pixel( glyph_ptr, x + 1, width ))
         {
-            if (glyph_ptr[x] <= 1) continue;
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
             val = aa_rgb( get_field(dst_ptr[x], dib->red_shift,   dib->red_len),
                           get_field(dst_ptr[x], dib->green_shift, dib->green_len),
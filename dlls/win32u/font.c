@@ -49,6 +49,7 @@ WINE_DEFAULT_DEBUG_CHANNEL(font);
 
 static HKEY wine_fonts_key;
 static HKEY wine_fonts_cache_key;
+static HANDLE font_index_section;
 HKEY hkcu_key;
 
 struct font_physdev
@@ -1405,6 +1406,278 @@ static void remove_face_from_cache( struct gdi_font_face *face )
     NtClose( hkey_family );
 }
 
+/* font index */
+
+/* The faces found when scanning the system fonts are stored by the first
+ * process of the session in a named section, and the following processes
+ * load them from there instead of scanning again. The section exists as long
+ * as one process keeps it open. Faces added through AddFontResource are still
+ * shared through the registry cache.
+ *
+ * The section name contains the write times of the font directories, so
+ * that adding or removing a font file makes the next process scan again and
+ * create a new index. */
+
+#define FONT_INDEX_MAGIC    0x58444946  /* "FIDX" */
+#define FONT_INDEX_VERSION  1
+
+struct font_index_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD size;
+    DWORD family_count;
+    DWORD face_count;
+    DWORD string_count;  /* in WCHARs */
+    /* struct font_index_family families[family_count]; */
+    /* struct font_index_face faces[face_count]; */
+    /* WCHAR strings[string_count]; */
+};
+
+struct font_index_family
+{
+    WCHAR family_name[LF_FACESIZE];
+    WCHAR second_name[LF_FACESIZE];
+    DWORD face_count;  /* faces are stored in family order */
+};
+
+struct font_index_face
+{
+    DWORD                   index;
+    DWORD                   flags;
+    DWORD                   ntmflags;
+    DWORD                   version;
+    DWORD                   scalable;
+    struct bitmap_font_size size;
+    FONTSIGNATURE           fs;
+    DWORD                   style_name;  /* offsets in the string table */
+    DWORD                   full_name;
+    DWORD                   file;
+};
+
+static ULONGLONG get_font_dir_write_time( const WCHAR *path )
+{
+    FILE_NETWORK_OPEN_INFORMATION info;
+    UNICODE_STRING nt_name;
+    OBJECT_ATTRIBUTES attr;
+    size_t len;
+
+    len = lstrlenW( path );
+    while (len && path[len - 1] == '\\') len--;
+
+    nt_name.Buffer = (WCHAR *)path;
+    nt_name.Length = nt_name.MaximumLength = len * sizeof(WCHAR);
+
+    attr.Length = sizeof(attr);
+    attr.RootDirectory = 0;
+    attr.Attributes = OBJ_CASE_INSENSITIVE;
+    attr.ObjectName = &nt_name;
+    attr.SecurityDescriptor = NULL;
+    attr.SecurityQualityOfService = NULL;
+
+    if (NtQueryFullAttributesFile( &attr, &info )) return 0;
+    return info.LastWriteTime.QuadPart;
+}
+
+static void get_font_index_name( UNICODE_STRING *name, WCHAR *buffer )
+{
+    WCHAR path[MAX_PATH];
+    ULONGLONG time;
+    char nameA[64];
+    int len;
+
+    get_fonts_win_dir_path( NULL, path );
+    time = get_font_dir_write_time( path );
+    get_fonts_data_dir_path( NULL, path );
+    time += get_font_dir_write_time( path );
+
+    len = sprintf( nameA, "\\BaseNamedObjects\\__WINE_FONT_INDEX_%08x%08x__",
+                   (UINT)(time >> 32), (UINT)time );
+    ascii_to_unicode( buffer, nameA, len );
+    name->Buffer = buffer;
+    name->Length = name->MaximumLength = len * sizeof(WCHAR);
+}
+
+static BOOL is_indexed_face( const struct gdi_font_face *face )
+{
+    return face->file && !face->data_ptr && !(face->flags & (ADDFONT_ADD_TO_CACHE | ADDFONT_ADD_RESOURCE));
+}
+
+static DWORD add_index_string( WCHAR *strings, DWORD *pos, const WCHAR *str )
+{
+    DWORD ret = *pos, len = lstrlenW( str ) + 1;
+
+    memcpy( strings + ret, str, len * sizeof(WCHAR) );
+    *pos += len;
+    return ret;
+}
+
+static void create_font_index(void)
+{
+    OBJECT_ATTRIBUTES attr = { sizeof(attr) };
+    UNICODE_STRING name;
+    struct font_index_header *header;
+    struct font_index_family *index_family;
+    struct font_index_face *index_face;
+    struct gdi_font_family *family;
+    struct gdi_font_face *face;
+    DWORD family_count = 0, face_count = 0, string_count = 0, count;
+    LARGE_INTEGER section_size;
+    SIZE_T view_size = 0;
+    void *ptr = NULL;
+    WCHAR *strings, nameW[64];
+
+    WINE_RB_FOR_EACH_ENTRY( family, &family_name_tree, struct gdi_font_family, name_entry )
+    {
+        count = 0;
+        LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
+        {
+            if (!is_indexed_face( face )) continue;
+            string_count += lstrlenW( face->style_name ) + lstrlenW( face->full_name ) + lstrlenW( face->file ) + 3;
+            count++;
+        }
+        if (!count) continue;
+        face_count += count;
+        family_count++;
+    }
+
+    section_size.QuadPart = sizeof(*header) + family_count * sizeof(*index_family) +
+                            face_count * sizeof(*index_face) + string_count * sizeof(WCHAR);
+
+    attr.ObjectName = &name;
+    get_font_index_name( &name, nameW );
+    if (NtCreateSection( &font_index_section, SECTION_ALL_ACCESS, &attr, &section_size,
+                         PAGE_READWRITE, SEC_COMMIT, 0 ))
+    {
+        WARN( "failed to create font index\n" );
+        font_index_section = 0;
+        return;
+    }
+    if (NtMapViewOfSection( font_index_section, GetCurrentProcess(), &ptr, 0, 0, NULL,
+                            &view_size, ViewShare, 0, PAGE_READWRITE ))
+    {
+        NtClose( font_index_section );
+        font_index_section = 0;
+        return;
+    }
+
+    header = ptr;
+    index_family = (struct font_index_family *)(header + 1);
+    index_face = (struct font_index_face *)(index_family + family_count);
+    strings = (WCHAR *)(index_face + face_count);
+    string_count = 0;
+
+    WINE_RB_FOR_EACH_ENTRY( family, &family_name_tree, struct gdi_font_family, name_entry )
+    {
+        count = 0;
+        LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
+        {
+            if (!is_indexed_face( face )) continue;
+            memset( index_face, 0, sizeof(*index_face) );
+            index_face->index      = face->face_index;
+            index_face->flags      = face->flags;
+            index_face->ntmflags   = face->ntmFlags;
+            index_face->version    = face->version;
+            index_face->scalable   = face->scalable;
+            index_face->fs         = face->fs;
+            index_face->style_name = add_index_string( strings, &string_count, face->style_name );
+            index_face->full_name  = add_index_string( strings, &string_count, face->full_name );
+            index_face->file       = add_index_string( strings, &string_count, face->file );
+            if (!face->scalable) index_face->size = face->size;
+            index_face++;
+            count++;
+        }
+        if (!count) continue;
+        memcpy( index_family->family_name, family->family_name, sizeof(family->family_name) );
+        memcpy( index_family->second_name, family->second_name, sizeof(family->second_name) );
+        index_family->face_count = count;
+        index_family++;
+    }
+
+    header->family_count = family_count;
+    header->face_count   = face_count;
+    header->string_count = string_count;
+    header->size         = section_size.QuadPart;
+    header->version      = FONT_INDEX_VERSION;
+    header->magic        = FONT_INDEX_MAGIC;
+    NtUnmapViewOfSection( GetCurrentProcess(), ptr );
+
+    TRACE( "created font index with %u families, %u faces, %u bytes\n",
+           family_count, face_count, (UINT)section_size.QuadPart );
+}
+
+static BOOL load_font_index(void)
+{
+    OBJECT_ATTRIBUTES attr = { sizeof(attr) };
+    UNICODE_STRING name;
+    const struct font_index_header *header;
+    const struct font_index_family *index_family;
+    const struct font_index_face *index_face;
+    struct gdi_font_family *family;
+    struct gdi_font_face *face;
+    const WCHAR *strings;
+    SIZE_T view_size = 0;
+    void *ptr = NULL;
+    WCHAR nameW[64];
+    DWORD i, j;
+
+    attr.ObjectName = &name;
+    get_font_index_name( &name, nameW );
+    if (NtOpenSection( &font_index_section, SECTION_MAP_READ, &attr ))
+    {
+        font_index_section = 0;
+        return FALSE;
+    }
+    if (NtMapViewOfSection( font_index_section, GetCurrentProcess(), &ptr, 0, 0, NULL,
+                            &view_size, ViewShare, 0, PAGE_READONLY ))
+        goto failed;
+
+    header = ptr;
+    if (view_size < sizeof(*header) || header->magic != FONT_INDEX_MAGIC ||
+        header->version != FONT_INDEX_VERSION || header->size > view_size ||
+        header->size != sizeof(*header) + header->family_count * sizeof(*index_family) +
+                        header->face_count * sizeof(*index_face) + header->string_count * sizeof(WCHAR))
+    {
+        WARN( "invalid font index\n" );
+        goto failed;
+    }
+
+    index_family = (const struct font_index_family *)(header + 1);
+    index_face = (const struct font_index_face *)(index_family + header->family_count);
+    strings = (const WCHAR *)(index_face + header->face_count);
+    if (header->string_count && strings[header->string_count - 1]) goto failed;
+
+    for (i = 0; i < header->family_count; i++, index_family++)
+    {
+        if (index_face + index_family->face_count > (const struct font_index_face *)strings) goto failed;
+
+        family = create_family( index_family->family_name, index_family->second_name );
+        for (j = 0; j < index_family->face_count; j++, index_face++)
+        {
+            if (index_face->style_name >= header->string_count ||
+                index_face->full_name >= header->string_count ||
+                index_face->file >= header->string_count)
+                continue;
+            if ((face = create_face( family, strings + index_face->style_name, strings + index_face->full_name,
+                                     strings + index_face->file, NULL, 0, index_face->index, index_face->fs,
+                                     index_face->ntmflags, index_face->version, index_face->flags,
+                                     index_face->scalable ? NULL : &index_face->size )))
+                release_face( face );
+        }
+        release_family( family );
+    }
+
+    TRACE( "loaded %u families, %u faces from the font index\n", header->family_count, header->face_count );
+    NtUnmapViewOfSection( GetCurrentProcess(), ptr );
+    return TRUE;
+
+failed:
+    if (ptr) NtUnmapViewOfSection( GetCurrentProcess(), ptr );
+    NtClose( font_index_section );
+    font_index_section = 0;
+    return FALSE;
+}
+
 /* font links */
 
 struct gdi_font_link
@@ -6094,6 +6367,13 @@ static void load_file_system_fonts(void)
     }
 }
 
+static void load_system_fonts(void)
+{
+    load_system_bitmap_fonts();
+    load_file_system_fonts();
+    font_funcs->load_fonts();
+}
+
 struct external_key
 {
     struct list entry;
@@ -6288,21 +6568,29 @@ UINT font_init(void)
     if (!(font_funcs = init_freetype_lib()))
         return dpi;
 
-    load_system_bitmap_fonts();
-    load_file_system_fonts();
-    font_funcs->load_fonts();
-
     attr.Attributes = OBJ_OPENIF;
     attr.ObjectName = &name;
     name.Buffer = wine_font_mutexW;
     name.Length = name.MaximumLength = sizeof(wine_font_mutexW);
 
-    if (NtCreateMutant( &mutex, MUTEX_ALL_ACCESS, &attr, FALSE ) < 0) return dpi;
+    if (NtCreateMutant( &mutex, MUTEX_ALL_ACCESS, &attr, FALSE ) < 0)
+    {
+        load_system_fonts();
+        return dpi;
+    }
     NtWaitForSingleObject( mutex, FALSE, NULL );
 
     wine_fonts_cache_key = reg_create_key( wine_fonts_key, cacheW, sizeof(cacheW),
                                            REG_OPTION_VOLATILE, &disposition );
 
+    /* scanning is done under the mutex, so that only the first process
+     * of the session needs to do it */
+    if (disposition == REG_CREATED_NEW_KEY || !load_font_index())
+    {
+        load_system_fonts();
+        create_font_index();
+    }
+
     if (disposition == REG_CREATED_NEW_KEY)
     {
         load_registry_fonts();
@@ -193,14 +193,17 @@ extern BITMAPINFO *copy_packed_dib( const BITMAPINFO *src_info, UINT usage ) DEC
 extern DWORD convert_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                                  const BITMAPINFO *dst_info, void *dst_bits ) DECLSPEC_HIDDEN;
 
-extern DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                                 const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
+extern DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, const struct gdi_image_bits *src_bits,
+                                 struct bitblt_coords *src, const BITMAPINFO *dst_info,
+                                 const struct gdi_image_bits *dst_bits, struct bitblt_coords *dst,
                                  INT mode ) DECLSPEC_HIDDEN;
-extern DWORD blend_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                               const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
+extern DWORD blend_bitmapinfo( const BITMAPINFO *src_info, const struct gdi_image_bits *src_bits,
+                               struct bitblt_coords *src, const BITMAPINFO *dst_info,
+                               const struct gdi_image_bits *dst_bits, struct bitblt_coords *dst,
                                BLENDFUNCTION blend ) DECLSPEC_HIDDEN;
-extern DWORD gradient_bitmapinfo( const BITMAPINFO *info, void *bits, TRIVERTEX *vert_array, ULONG nvert,
-                                  void *grad_array, ULONG ngrad, ULONG mode, const POINT *dev_pts, HRGN rgn ) DECLSPEC_HIDDEN;
+extern DWORD gradient_bitmapinfo( const BITMAPINFO *info, const struct gdi_image_bits *bits, TRIVERTEX *vert_array,
+                                  ULONG nvert, void *grad_array, ULONG ngrad, ULONG mode, const POINT *dev_pts,
+                                  HRGN rgn ) DECLSPEC_HIDDEN;
 extern COLORREF get_pixel_bitmapinfo( const BITMAPINFO *info, void *bits, struct bitblt_coords *src ) DECLSPEC_HIDDEN;
 extern BOOL render_aa_text_bitmapinfo( DC *dc, BITMAPINFO *info, struct gdi_image_bits *bits,
                                        struct bitblt_coords *src, INT x, INT y, UINT flags,
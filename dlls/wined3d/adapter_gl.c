@@ -88,6 +88,7 @@ static const struct wined3d_extension_map gl_extension_map[] =
     {"GL_ARB_framebuffer_object",           ARB_FRAMEBUFFER_OBJECT        },
     {"GL_ARB_framebuffer_sRGB",             ARB_FRAMEBUFFER_SRGB          },
     {"GL_ARB_geometry_shader4",             ARB_GEOMETRY_SHADER4          },
+    {"GL_ARB_get_program_binary",           ARB_GET_PROGRAM_BINARY        },
     {"GL_ARB_gpu_shader5",                  ARB_GPU_SHADER5               },
     {"GL_ARB_half_float_pixel",             ARB_HALF_FLOAT_PIXEL          },
     {"GL_ARB_half_float_vertex",            ARB_HALF_FLOAT_VERTEX         },
@@ -99,6 +100,7 @@ static const struct wined3d_extension_map gl_extension_map[] =
     {"GL_ARB_multisample",                  ARB_MULTISAMPLE               },
     {"GL_ARB_multitexture",                 ARB_MULTITEXTURE              },
     {"GL_ARB_occlusion_query",              ARB_OCCLUSION_QUERY           },
+    {"GL_ARB_parallel_shader_compile",      ARB_PARALLEL_SHADER_COMPILE   },
     {"GL_ARB_pipeline_statistics_query",    ARB_PIPELINE_STATISTICS_QUERY },
     {"GL_ARB_pixel_buffer_object",          ARB_PIXEL_BUFFER_OBJECT       },
     {"GL_ARB_point_parameters",             ARB_POINT_PARAMETERS          },
@@ -2187,6 +2189,10 @@ static void load_gl_funcs(struct wined3d_gl_info *gl_info)
     USE_GL_FUNC(glFramebufferTextureFaceARB)
     USE_GL_FUNC(glFramebufferTextureLayerARB)
     USE_GL_FUNC(glProgramParameteriARB)
+    /* GL_ARB_get_program_binary */
+    USE_GL_FUNC(glGetProgramBinary)
+    USE_GL_FUNC(glProgramBinary)
+    USE_GL_FUNC(glProgramParameteri)
     /* GL_ARB_instanced_arrays */
     USE_GL_FUNC(glVertexAttribDivisorARB)
     /* GL_ARB_internalformat_query */
@@ -2220,6 +2226,8 @@ static void load_gl_funcs(struct wined3d_gl_info *gl_info)
     USE_GL_FUNC(glGetQueryObjectivARB)
     USE_GL_FUNC(glGetQueryObjectuivARB)
     USE_GL_FUNC(glIsQueryARB)
+    /* GL_ARB_parallel_shader_compile */
+    USE_GL_FUNC(glMaxShaderCompilerThreadsARB)
     /* GL_ARB_point_parameters */
     USE_GL_FUNC(glPointParameterfARB)
     USE_GL_FUNC(glPointParameterfvARB)
@@ -3352,6 +3360,7 @@ static BOOL wined3d_adapter_init_gl_caps(struct wined3d_adapter *adapter,
         {ARB_TRANSFORM_FEEDBACK3,          MAKEDWORD_VERSION(4, 0)},
 
         {ARB_ES2_COMPATIBILITY,            MAKEDWORD_VERSION(4, 1)},
+        {ARB_GET_PROGRAM_BINARY,           MAKEDWORD_VERSION(4, 1)},
         {ARB_VIEWPORT_ARRAY,               MAKEDWORD_VERSION(4, 1)},
 
         {ARB_BASE_INSTANCE,                MAKEDWORD_VERSION(4, 2)},
@@ -4284,7 +4284,18 @@ static BOOL context_apply_draw_state(struct wined3d_context *context,
 
     if (context->shader_update_mask & ~(1u << WINED3D_SHADER_TYPE_COMPUTE))
     {
+        uint32_t shader_update_mask = context->shader_update_mask;
+
         device->shader_backend->shader_select(device->shader_priv, context, state);
+        if (context->shader_program_pending)
+        {
+            /* The shader backend is still compiling the program in the
+             * background. Skip the draw and select the shaders again on the
+             * next one. */
+            context->shader_program_pending = 0;
+            context->shader_update_mask |= shader_update_mask;
+            return FALSE;
+        }
         context->shader_update_mask &= 1u << WINED3D_SHADER_TYPE_COMPUTE;
     }
 
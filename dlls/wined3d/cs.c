@@ -637,6 +637,12 @@ static void wined3d_cs_exec_nop(struct wined3d_cs *cs, const void *data)
 {
 }
 
+static void wined3d_cs_wake_producers(struct wined3d_cs *cs, const void *addr)
+{
+    if (*(volatile LONG *)&cs->waiting_producers)
+        RtlWakeAddressAll(addr);
+}
+
 static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
 {
     struct wined3d_texture *logo_texture, *cursor_texture, *back_buffer;
@@ -715,12 +721,14 @@ static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
     }
 
     InterlockedDecrement(&cs->pending_presents);
+    wined3d_cs_wake_producers(cs, &cs->pending_presents);
 }
 
 void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *swapchain,
         const RECT *src_rect, const RECT *dst_rect, HWND dst_window_override,
         unsigned int swap_interval, DWORD flags)
 {
+    unsigned int spin_count = 0;
     struct wined3d_cs_present *op;
     unsigned int i;
     LONG pending;
@@ -748,7 +756,7 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
      * ahead of the worker thread. */
     while (pending >= swapchain->max_frame_latency)
     {
-        YieldProcessor();
+        wined3d_cs_wait_progress(cs, &spin_count, (ULONG *)&cs->pending_presents, pending);
         pending = InterlockedCompareExchange(&cs->pending_presents, 0, 0);
     }
 }
@@ -3109,6 +3117,61 @@ static const struct wined3d_device_context_ops wined3d_cs_st_ops =
     wined3d_cs_reference_command_list,
 };
 
+/* Producers waiting for the CS thread spin for a while, and then sleep until
+ * the value they're waiting on changes. The CS thread only needs to wake them
+ * up if somebody is actually waiting. */
+void wined3d_cs_wait_progress(struct wined3d_cs *cs, unsigned int *spin_count,
+        const volatile ULONG *addr, ULONG value)
+{
+    if (*spin_count < cs->producer_spin_limit)
+    {
+        ++*spin_count;
+        YieldProcessor();
+        return;
+    }
+
+    InterlockedIncrement(&cs->waiting_producers);
+    RtlWaitOnAddress((const void *)addr, &value, sizeof(value), NULL);
+    InterlockedDecrement(&cs->waiting_producers);
+}
+
+static LONGLONG wined3d_cs_stats_elapsed(const LARGE_INTEGER *start)
+{
+    LARGE_INTEGER now;
+
+    QueryPerformanceCounter(&now);
+    return now.QuadPart - start->QuadPart;
+}
+
+static void wined3d_cs_report_stats(struct wined3d_cs *cs)
+{
+    struct wined3d_cs_stats *stats = &cs->stats;
+    LONGLONG elapsed, require_space_time, finish_time;
+    LARGE_INTEGER now;
+    ULONG max_occupancy;
+
+    QueryPerformanceCounter(&now);
+    if ((elapsed = now.QuadPart - stats->start.QuadPart) < stats->frequency.QuadPart)
+        return;
+
+    /* The occupancy and wait times are updated by the producer threads. */
+    max_occupancy = InterlockedExchange(&stats->max_occupancy, 0);
+    require_space_time = InterlockedExchangeAdd64(&stats->require_space_time, 0);
+    InterlockedExchangeAdd64(&stats->require_space_time, -require_space_time);
+    finish_time = InterlockedExchangeAdd64(&stats->finish_time, 0);
+    InterlockedExchangeAdd64(&stats->finish_time, -finish_time);
+
+    TRACE_(d3d_perf)("%s packets/s, max queue occupancy %u KiB, "
+            "%s us/s waiting for queue space, %s us/s waiting in finish.\n",
+            wine_dbgstr_longlong(stats->packet_count * stats->frequency.QuadPart / elapsed),
+            max_occupancy / 1024,
+            wine_dbgstr_longlong(require_space_time * 1000000 / elapsed),
+            wine_dbgstr_longlong(finish_time * 1000000 / elapsed));
+
+    stats->start = now;
+    stats->packet_count = 0;
+}
+
 static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct wined3d_cs_queue *queue)
 {
     wined3d_from_cs(cs);
@@ -3125,8 +3188,17 @@ static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
     InterlockedExchange((LONG *)&queue->head, queue->head + packet_size);
 
-    if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
-        SetEvent(cs->event);
+    if (cs->stats.enabled)
+    {
+        LONG occupancy = queue->head - *(volatile ULONG *)&queue->tail;
+        LONG max = *(volatile LONG *)&cs->stats.max_occupancy, prev;
+
+        while (occupancy > max && (prev = InterlockedCompareExchange(&cs->stats.max_occupancy, occupancy, max)) != max)
+            max = prev;
+    }
+
+    if (InterlockedCompareExchange(&cs->waiting_for_work, FALSE, TRUE))
+        RtlWakeAddressAll(&cs->waiting_for_work);
 }
 
 static void wined3d_cs_mt_submit(struct wined3d_device_context *context, enum wined3d_cs_queue_id queue_id)
@@ -3145,6 +3217,8 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
     size_t header_size, packet_size, remaining;
     struct wined3d_cs_packet *packet;
     ULONG head = queue->head & WINED3D_CS_QUEUE_MASK;
+    LARGE_INTEGER wait_start = {{0}};
+    unsigned int spin_count = 0;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
@@ -3177,7 +3251,8 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 
     for (;;)
     {
-        ULONG tail = (*(volatile ULONG *)&queue->tail) & WINED3D_CS_QUEUE_MASK;
+        ULONG queue_tail = *(volatile ULONG *)&queue->tail;
+        ULONG tail = queue_tail & WINED3D_CS_QUEUE_MASK;
         ULONG new_pos;
 
         /* Empty. */
@@ -3195,8 +3270,14 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
+        if (cs->stats.enabled && !wait_start.QuadPart)
+            QueryPerformanceCounter(&wait_start);
+        wined3d_cs_wait_progress(cs, &spin_count, &queue->tail, queue_tail);
     }
 
+    if (wait_start.QuadPart)
+        InterlockedExchangeAdd64(&cs->stats.require_space_time, wined3d_cs_stats_elapsed(&wait_start));
+
     packet = (struct wined3d_cs_packet *)&queue->data[head];
     packet->size = size;
     return packet->data;
@@ -3216,12 +3297,22 @@ static void *wined3d_cs_mt_require_space(struct wined3d_device_context *context,
 static void wined3d_cs_mt_finish(struct wined3d_device_context *context, enum wined3d_cs_queue_id queue_id)
 {
     struct wined3d_cs *cs = wined3d_cs_from_context(context);
+    struct wined3d_cs_queue *queue = &cs->queue[queue_id];
+    LARGE_INTEGER wait_start = {{0}};
+    unsigned int spin_count = 0;
+    ULONG tail;
 
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(context, queue_id);
 
-    while (cs->queue[queue_id].head != *(volatile ULONG *)&cs->queue[queue_id].tail)
-        YieldProcessor();
+    if (cs->stats.enabled)
+        QueryPerformanceCounter(&wait_start);
+
+    while (queue->head != (tail = *(volatile ULONG *)&queue->tail))
+        wined3d_cs_wait_progress(cs, &spin_count, &queue->tail, tail);
+
+    if (cs->stats.enabled)
+        InterlockedExchangeAdd64(&cs->stats.finish_time, wined3d_cs_stats_elapsed(&wait_start));
 }
 
 static const struct wined3d_device_context_ops wined3d_cs_mt_ops =
@@ -3253,23 +3344,29 @@ static void poll_queries(struct wined3d_cs *cs)
     }
 }
 
-static void wined3d_cs_wait_event(struct wined3d_cs *cs)
+static void wined3d_cs_wait_for_work(struct wined3d_cs *cs)
 {
-    InterlockedExchange(&cs->waiting_for_event, TRUE);
+    static const LONG waiting = TRUE;
+    LARGE_INTEGER timeout;
+
+    InterlockedExchange(&cs->waiting_for_work, TRUE);
 
     /* The main thread might have enqueued a command and blocked on it after
-     * the CS thread decided to enter wined3d_cs_wait_event(), but before
-     * "waiting_for_event" was set.
-     *
-     * Likewise, we can race with the main thread when resetting
-     * "waiting_for_event", in which case we would need to call
-     * WaitForSingleObject() because the main thread called SetEvent(). */
+     * the CS thread decided to enter wined3d_cs_wait_for_work(), but before
+     * "waiting_for_work" was set. RtlWaitOnAddress() returns immediately if
+     * the main thread has reset "waiting_for_work" in the meantime. */
     if (!(wined3d_cs_queue_is_empty(cs, &cs->queue[WINED3D_CS_QUEUE_DEFAULT])
-            && wined3d_cs_queue_is_empty(cs, &cs->queue[WINED3D_CS_QUEUE_MAP]))
-            && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
+            && wined3d_cs_queue_is_empty(cs, &cs->queue[WINED3D_CS_QUEUE_MAP])))
+    {
+        InterlockedExchange(&cs->waiting_for_work, FALSE);
         return;
+    }
 
-    WaitForSingleObject(cs->event, INFINITE);
+    /* Queries still need to be polled, so only sleep for a short while. */
+    timeout.QuadPart = -10000;
+    RtlWaitOnAddress(&cs->waiting_for_work, &waiting, sizeof(waiting),
+            list_empty(&cs->query_poll_list) ? NULL : &timeout);
+    InterlockedExchange(&cs->waiting_for_work, FALSE);
 }
 
 static void wined3d_cs_command_lock(const struct wined3d_cs *cs)
@@ -3309,9 +3406,11 @@ static inline bool wined3d_cs_execute_next(struct wined3d_cs *cs, struct wined3d
         wined3d_cs_op_handlers[opcode](cs, packet->data);
         wined3d_cs_command_unlock(cs);
         TRACE("%s at %p executed.\n", debug_cs_op(opcode), packet);
+        ++cs->stats.packet_count;
     }
 
     InterlockedExchange((LONG *)&queue->tail, tail);
+    wined3d_cs_wake_producers(cs, &queue->tail);
     return true;
 }
 
@@ -3368,6 +3467,8 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             wined3d_cs_command_lock(cs);
             poll_queries(cs);
             wined3d_cs_command_unlock(cs);
+            if (cs->stats.enabled)
+                wined3d_cs_report_stats(cs);
             poll = 0;
         }
 
@@ -3377,18 +3478,33 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
-                if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
-                    wined3d_cs_wait_event(cs);
+                if (++spin_count >= cs->spin_limit)
+                {
+                    /* Nothing arrived while spinning; spin for a shorter
+                     * time before sleeping next time. */
+                    cs->spin_limit = max(cs->spin_limit / 2, WINED3D_CS_MIN_SPIN_COUNT);
+                    wined3d_cs_wait_for_work(cs);
+                    spin_count = 0;
+                }
                 continue;
             }
         }
-        spin_count = 0;
+        if (spin_count)
+        {
+            /* Work arrived while spinning; keep spinning for longer next
+             * time, since it avoids the latency of a wake-up. */
+            if (spin_count > cs->spin_limit / 2)
+                cs->spin_limit = min(cs->spin_limit * 2, cs->max_spin_limit);
+            spin_count = 0;
+        }
 
         run = wined3d_cs_execute_next(cs, queue);
     }
 
     cs->queue[WINED3D_CS_QUEUE_MAP].tail = cs->queue[WINED3D_CS_QUEUE_MAP].head;
     cs->queue[WINED3D_CS_QUEUE_DEFAULT].tail = cs->queue[WINED3D_CS_QUEUE_DEFAULT].head;
+    RtlWakeAddressAll(&cs->queue[WINED3D_CS_QUEUE_MAP].tail);
+    RtlWakeAddressAll(&cs->queue[WINED3D_CS_QUEUE_DEFAULT].tail);
     TRACE("Stopped.\n");
     FreeLibraryAndExitThread(wined3d_module, 0);
 }
@@ -3415,6 +3531,12 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
     if (cs->serialize_commands)
         ERR_(d3d_sync)("Forcing serialization of all command streams.\n");
 
+    if ((cs->stats.enabled = TRACE_ON(d3d_perf)))
+    {
+        QueryPerformanceFrequency(&cs->stats.frequency);
+        QueryPerformanceCounter(&cs->stats.start);
+    }
+
     state_init(&cs->state, d3d_info, WINED3D_STATE_NO_REF | WINED3D_STATE_INIT_DEFAULT, cs->c.state->feature_level);
 
     cs->data_size = WINED3D_INITIAL_CS_SIZE;
@@ -3426,18 +3548,24 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
     {
         cs->c.ops = &wined3d_cs_mt_ops;
 
-        if (!(cs->event = CreateEventW(NULL, FALSE, FALSE, NULL)))
+        /* In power saving mode, sleep almost right away instead of spinning
+         * in the hope that more work arrives soon. */
+        if (wined3d_settings.cs_multithreaded & WINED3D_CSMT_POWER_SAVE)
         {
-            ERR("Failed to create command stream event.\n");
-            heap_free(cs->data);
-            goto fail;
+            cs->max_spin_limit = WINED3D_CS_MIN_SPIN_COUNT;
+            cs->producer_spin_limit = WINED3D_CS_MIN_SPIN_COUNT;
+        }
+        else
+        {
+            cs->max_spin_limit = WINED3D_CS_SPIN_COUNT;
+            cs->producer_spin_limit = WINED3D_CS_PRODUCER_SPIN_COUNT;
         }
+        cs->spin_limit = cs->max_spin_limit;
 
         if (!(GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
                 (const WCHAR *)wined3d_cs_run, &cs->wined3d_module)))
         {
             ERR("Failed to get wined3d module handle.\n");
-            CloseHandle(cs->event);
             heap_free(cs->data);
             goto fail;
         }
@@ -3446,7 +3574,6 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
         {
             ERR("Failed to create wined3d command stream thread.\n");
             FreeLibrary(cs->wined3d_module);
-            CloseHandle(cs->event);
             heap_free(cs->data);
             goto fail;
         }
@@ -3467,8 +3594,6 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
     {
         wined3d_cs_emit_stop(cs);
         CloseHandle(cs->thread);
-        if (!CloseHandle(cs->event))
-            ERR("Closing event failed.\n");
     }
 
     wined3d_state_destroy(cs->c.state);
@@ -4305,8 +4430,7 @@ HRESULT CDECL wined3d_deferred_context_record_command_list(struct wined3d_device
     memory = heap_alloc(sizeof(*object) + deferred->resource_count * sizeof(*object->resources)
             + deferred->upload_count * sizeof(*object->uploads)
             + deferred->command_list_count * sizeof(*object->command_lists)
-            + deferred->query_count * sizeof(*object->queries)
-            + deferred->data_size);
+            + deferred->query_count * sizeof(*object->queries));
 
     if (!memory)
     {
@@ -4345,9 +4469,14 @@ HRESULT CDECL wined3d_deferred_context_record_command_list(struct wined3d_device
     memcpy(object->queries, deferred->queries, deferred->query_count * sizeof(*object->queries));
     /* Transfer our references to the queries to the command list. */
 
-    object->data = memory;
+    /* Hand the recorded packets over to the command list instead of copying
+     * them; they can be large. Start the next recording with a buffer of the
+     * same size, so that it doesn't have to grow it again. */
+    object->data = deferred->data;
     object->data_size = deferred->data_size;
-    memcpy(object->data, deferred->data, deferred->data_size);
+    deferred->data = NULL;
+    deferred->data_capacity = 0;
+    wined3d_array_reserve(&deferred->data, &deferred->data_capacity, object->data_size, 1);
 
     deferred->data_size = 0;
     deferred->resource_count = 0;
@@ -4391,6 +4520,7 @@ static void wined3d_command_list_destroy_object(void *object)
         }
     }
 
+    heap_free(list->data);
     heap_free(list);
 }
 
@@ -31,11 +31,13 @@
 
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
 WINE_DECLARE_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 #define WINED3D_GLSL_SAMPLE_PROJECTED   0x01
@@ -138,6 +140,13 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    struct wined3d_shader_cache *program_cache;
+    BOOL program_cache_initialised;
+
+    unsigned int async_links;
+    unsigned int skipped_draws;
+    LONGLONG async_link_time;
 };
 
 struct glsl_vs_program
@@ -252,7 +261,14 @@ struct glsl_shader_prog_link
     unsigned int constant_version;
     DWORD shader_controlled_clip_distances : 1;
     DWORD clip_distance_mask : 8; /* WINED3D_MAX_CLIP_DISTANCES, 8 */
-    DWORD padding : 23;
+    DWORD link_pending : 1;
+    DWORD padding : 22;
+
+    /* Used while the link is pending, see shader_glsl_complete_link(). */
+    struct wined3d_shader *link_shaders[WINED3D_SHADER_TYPE_GRAPHICS_COUNT];
+    void *link_cache_key;
+    size_t link_cache_key_size;
+    LARGE_INTEGER link_start;
 };
 
 struct glsl_program_key
@@ -636,6 +652,145 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+static struct wined3d_shader_cache *shader_glsl_get_program_cache(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv)
+{
+    char driver_id[1024];
+    GLint format_count = 0;
+
+    if (priv->program_cache_initialised)
+        return priv->program_cache;
+    priv->program_cache_initialised = TRUE;
+
+    if (!wined3d_settings.shader_cache_path || !gl_info->supported[ARB_GET_PROGRAM_BINARY])
+        return NULL;
+    gl_info->gl_ops.gl.p_glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    if (!format_count)
+    {
+        WARN("No program binary formats supported.\n");
+        return NULL;
+    }
+
+    /* Program binaries are only valid for the driver that created them. The
+     * version prefix should be bumped when the way programs are set up
+     * outside of their GLSL source changes. */
+    snprintf(driver_id, sizeof(driver_id), "wined3d-glsl-1|%s|%s|%s",
+            (const char *)gl_info->gl_ops.gl.p_glGetString(GL_VENDOR),
+            (const char *)gl_info->gl_ops.gl.p_glGetString(GL_RENDERER),
+            (const char *)gl_info->gl_ops.gl.p_glGetString(GL_VERSION));
+    priv->program_cache = wined3d_shader_cache_create(driver_id);
+    return priv->program_cache;
+}
+
+struct glsl_program_cache_source
+{
+    char *source;
+    GLsizei length;
+};
+
+static int __cdecl glsl_program_cache_source_compare(const void *a, const void *b)
+{
+    const struct glsl_program_cache_source *s1 = a, *s2 = b;
+
+    if (s1->length != s2->length)
+        return s1->length < s2->length ? -1 : 1;
+    return memcmp(s1->source, s2->source, s1->length);
+}
+
+/* Build the program cache key from the source of the attached shaders. The
+ * key is the concatenation of the sources, each prefixed with its length. */
+static void *shader_glsl_get_program_cache_key(const struct wined3d_gl_info *gl_info,
+        GLuint program_id, size_t *key_size)
+{
+    struct glsl_program_cache_source sources[WINED3D_SHADER_TYPE_GRAPHICS_COUNT + 1];
+    GLuint shader_ids[ARRAY_SIZE(sources)];
+    GLsizei count = 0, loaded, i;
+    uint8_t *key = NULL, *ptr;
+    uint32_t length;
+    size_t size = 0;
+    GLint source_length;
+
+    GL_EXTCALL(glGetAttachedShaders(program_id, ARRAY_SIZE(shader_ids), &count, shader_ids));
+    for (loaded = 0; loaded < count; ++loaded)
+    {
+        GL_EXTCALL(glGetShaderiv(shader_ids[loaded], GL_SHADER_SOURCE_LENGTH, &source_length));
+        if (!(sources[loaded].source = heap_alloc(source_length + 1)))
+            goto done;
+        GL_EXTCALL(glGetShaderSource(shader_ids[loaded], source_length + 1,
+                &sources[loaded].length, sources[loaded].source));
+        size += sizeof(length) + sources[loaded].length;
+    }
+    checkGLcall("get program source");
+
+    /* The order in which shaders are returned isn't defined. */
+    qsort(sources, count, sizeof(*sources), glsl_program_cache_source_compare);
+
+    if (!count || !(key = heap_alloc(size)))
+        goto done;
+    for (i = 0, ptr = key; i < count; ++i)
+    {
+        length = sources[i].length;
+        memcpy(ptr, &length, sizeof(length));
+        ptr += sizeof(length);
+        memcpy(ptr, sources[i].source, length);
+        ptr += length;
+    }
+    *key_size = size;
+
+done:
+    for (i = 0; i < loaded; ++i)
+        heap_free(sources[i].source);
+    return key;
+}
+
+static BOOL shader_glsl_load_program_binary(const struct wined3d_gl_info *gl_info,
+        struct wined3d_shader_cache *cache, GLuint program_id, const void *key, size_t key_size)
+{
+    uint32_t format;
+    GLint status;
+    size_t size;
+    void *data;
+
+    if (!(data = wined3d_shader_cache_load(cache, key, key_size, &format, &size)))
+        return FALSE;
+
+    GL_EXTCALL(glProgramBinary(program_id, format, data, size));
+    heap_free(data);
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    /* The binary may be rejected, e.g. after a driver update that didn't
+     * change the version string. */
+    gl_info->gl_ops.gl.p_glGetError();
+    if (!status)
+    {
+        WARN("Failed to load program binary for program %u.\n", program_id);
+        return FALSE;
+    }
+
+    TRACE("Loaded program %u from the program cache.\n", program_id);
+    return TRUE;
+}
+
+static void shader_glsl_store_program_binary(const struct wined3d_gl_info *gl_info,
+        struct wined3d_shader_cache *cache, GLuint program_id, const void *key, size_t key_size)
+{
+    GLint status, size = 0;
+    GLsizei length;
+    GLenum format;
+    void *data;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    if (!status)
+        return;
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &size));
+    if (!size || !(data = heap_alloc(size)))
+        return;
+    GL_EXTCALL(glGetProgramBinary(program_id, size, &length, &format, data));
+    checkGLcall("glGetProgramBinary");
+    if (length)
+        wined3d_shader_cache_store(cache, key, key_size, format, data, length);
+    heap_free(data);
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -6874,6 +7029,8 @@ static void delete_glsl_program_entry(struct shader_glsl_priv *priv, const struc
     wine_rb_remove(&priv->program_lookup, &entry->program_lookup_entry);
 
     GL_EXTCALL(glDeleteProgram(entry->id));
+    if (entry->link_pending)
+        heap_free(entry->link_cache_key);
     if (entry->vs.id)
         list_remove(&entry->vs.shader_entry);
     if (entry->hs.id)
@@ -10145,6 +10302,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
     entry->cs.id = shader_id;
     entry->constant_version = 0;
     entry->shader_controlled_clip_distances = 0;
+    entry->link_pending = 0;
     entry->ps.np2_fixup_info = NULL;
     add_glsl_program_entry(priv, entry);
 
@@ -10215,18 +10373,214 @@ static void set_glsl_compute_shader_program(const struct wined3d_context_gl *con
     ctx_data->glsl_program = entry;
 }
 
+/* Context activation is done by the caller. */
+static void shader_glsl_init_program(const struct wined3d_context_gl *context_gl, struct shader_glsl_priv *priv,
+        struct glsl_shader_prog_link *entry, struct wined3d_shader *vshader, struct wined3d_shader *hshader,
+        struct wined3d_shader *dshader, struct wined3d_shader *gshader, struct wined3d_shader *pshader)
+{
+    const struct wined3d_gl_info *gl_info = context_gl->gl_info;
+    const struct wined3d_shader *pre_rasterization_shader;
+    unsigned int i;
+
+    shader_glsl_init_vs_uniform_locations(gl_info, priv, entry->id, &entry->vs,
+            vshader ? vshader->limits->constant_float : 0);
+    shader_glsl_init_ds_uniform_locations(gl_info, priv, entry->id, &entry->ds);
+    shader_glsl_init_gs_uniform_locations(gl_info, priv, entry->id, &entry->gs);
+    shader_glsl_init_ps_uniform_locations(gl_info, priv, entry->id, &entry->ps,
+            pshader ? pshader->limits->constant_float : 0);
+    checkGLcall("find glsl program uniform locations");
+
+    pre_rasterization_shader = gshader ? gshader : dshader ? dshader : vshader;
+    if (pre_rasterization_shader && pre_rasterization_shader->reg_maps.shader_version.major >= 4)
+    {
+        unsigned int clip_distance_count = wined3d_popcount(pre_rasterization_shader->reg_maps.clip_distance_mask);
+        entry->shader_controlled_clip_distances = 1;
+        entry->clip_distance_mask = wined3d_mask_from_size(clip_distance_count);
+    }
+
+    if (needs_legacy_glsl_syntax(gl_info))
+    {
+        if (pshader && pshader->reg_maps.shader_version.major >= 3
+                && pshader->u.ps.declared_in_count > vec4_varyings(3, gl_info))
+        {
+            TRACE("Shader %d needs vertex color clamping disabled.\n", entry->id);
+            entry->vs.vertex_color_clamp = GL_FALSE;
+        }
+        else
+        {
+            entry->vs.vertex_color_clamp = GL_FIXED_ONLY_ARB;
+        }
+    }
+    else
+    {
+        /* With core profile we never change vertex_color_clamp from
+         * GL_FIXED_ONLY_MODE (which is also the initial value) so we never call
+         * glClampColorARB(). */
+        entry->vs.vertex_color_clamp = GL_FIXED_ONLY_ARB;
+    }
+
+    /* Set the shader to allow uniform loading on it */
+    GL_EXTCALL(glUseProgram(entry->id));
+    checkGLcall("glUseProgram");
+
+    entry->constant_update_mask = 0;
+    if (vshader)
+    {
+        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_F;
+        if (vshader->reg_maps.integer_constants)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_I;
+        if (vshader->reg_maps.boolean_constants)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_B;
+        if (entry->vs.pos_fixup_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
+        if (entry->vs.base_vertex_id_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_BASE_VERTEX_ID;
+
+        shader_glsl_load_program_resources(context_gl, priv, entry->id, vshader);
+    }
+    else
+    {
+        entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_MODELVIEW
+                | WINED3D_SHADER_CONST_FFP_PROJ;
+
+        for (i = 1; i < MAX_VERTEX_BLENDS; ++i)
+        {
+            if (entry->vs.modelview_matrix_location[i] != -1)
+            {
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_VERTEXBLEND;
+                break;
+            }
+        }
+
+        for (i = 0; i < WINED3D_MAX_TEXTURES; ++i)
+        {
+            if (entry->vs.texture_matrix_location[i] != -1)
+            {
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_TEXMATRIX;
+                break;
+            }
+        }
+        if (entry->vs.material_ambient_location != -1 || entry->vs.material_diffuse_location != -1
+                || entry->vs.material_specular_location != -1
+                || entry->vs.material_emissive_location != -1
+                || entry->vs.material_shininess_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_MATERIAL;
+        if (entry->vs.light_ambient_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_LIGHTS;
+    }
+    if (entry->vs.clip_planes_location != -1)
+        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_CLIP_PLANES;
+    if (entry->vs.pointsize_min_location != -1)
+        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_POINTSIZE;
+
+    if (hshader)
+        shader_glsl_load_program_resources(context_gl, priv, entry->id, hshader);
+
+    if (dshader)
+    {
+        if (entry->ds.pos_fixup_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
+
+        shader_glsl_load_program_resources(context_gl, priv, entry->id, dshader);
+    }
+
+    if (gshader)
+    {
+        if (entry->gs.pos_fixup_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
+
+        shader_glsl_load_program_resources(context_gl, priv, entry->id, gshader);
+    }
+
+    if (entry->ps.id)
+    {
+        if (pshader)
+        {
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_F;
+            if (pshader->reg_maps.integer_constants)
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_I;
+            if (pshader->reg_maps.boolean_constants)
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_B;
+            if (entry->ps.ycorrection_location != -1)
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_Y_CORR;
+
+            shader_glsl_load_program_resources(context_gl, priv, entry->id, pshader);
+            shader_glsl_load_images(gl_info, priv, entry->id, &pshader->reg_maps);
+        }
+        else
+        {
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_PS;
+
+            shader_glsl_load_samplers(&context_gl->c, priv, entry->id, NULL);
+        }
+
+        for (i = 0; i < WINED3D_MAX_TEXTURES; ++i)
+        {
+            if (entry->ps.bumpenv_mat_location[i] != -1)
+            {
+                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_BUMP_ENV;
+                break;
+            }
+        }
+
+        if (entry->ps.fog_color_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_FOG;
+        if (entry->ps.alpha_test_ref_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_ALPHA_TEST;
+        if (entry->ps.np2_fixup_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_NP2_FIXUP;
+        if (entry->ps.color_key_location != -1)
+            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_COLOR_KEY;
+    }
+}
+
+/* Context activation is done by the caller. Returns FALSE if the driver is
+ * still linking the program. */
+static BOOL shader_glsl_complete_link(const struct wined3d_context_gl *context_gl,
+        struct shader_glsl_priv *priv, struct glsl_shader_prog_link *entry)
+{
+    const struct wined3d_gl_info *gl_info = context_gl->gl_info;
+    struct wined3d_shader **shaders = entry->link_shaders;
+    LARGE_INTEGER now;
+    GLint complete;
+
+    GL_EXTCALL(glGetProgramiv(entry->id, GL_COMPLETION_STATUS_ARB, &complete));
+    if (!complete)
+        return FALSE;
+
+    QueryPerformanceCounter(&now);
+    priv->async_link_time += now.QuadPart - entry->link_start.QuadPart;
+    TRACE("GLSL shader program %u is ready.\n", entry->id);
+
+    entry->link_pending = 0;
+    shader_glsl_validate_link(gl_info, entry->id);
+    if (entry->link_cache_key)
+    {
+        shader_glsl_store_program_binary(gl_info, priv->program_cache, entry->id,
+                entry->link_cache_key, entry->link_cache_key_size);
+        heap_free(entry->link_cache_key);
+    }
+
+    shader_glsl_init_program(context_gl, priv, entry, shaders[WINED3D_SHADER_TYPE_VERTEX],
+            shaders[WINED3D_SHADER_TYPE_HULL], shaders[WINED3D_SHADER_TYPE_DOMAIN],
+            shaders[WINED3D_SHADER_TYPE_GEOMETRY], shaders[WINED3D_SHADER_TYPE_PIXEL]);
+    return TRUE;
+}
+
 /* Context activation is done by the caller. */
 static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl, const struct wined3d_state *state,
         struct shader_glsl_priv *priv, struct glsl_context_data *ctx_data)
 {
     const struct wined3d_d3d_info *d3d_info = context_gl->c.d3d_info;
     const struct wined3d_gl_info *gl_info = context_gl->gl_info;
-    const struct wined3d_shader *pre_rasterization_shader;
     const struct ps_np2fixup_info *np2fixup_info = NULL;
     struct wined3d_shader *hshader, *dshader, *gshader;
     struct glsl_shader_prog_link *entry = NULL;
+    struct wined3d_shader_cache *program_cache;
     struct wined3d_shader *vshader = NULL;
     struct wined3d_shader *pshader = NULL;
+    size_t program_cache_key_size = 0;
+    void *program_cache_key = NULL;
     GLuint reorder_shader_id = 0;
     struct glsl_program_key key;
     uint32_t attribs_map;
@@ -10345,6 +10699,8 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
     key.cs_id = 0;
     if ((!vs_id && !hs_id && !ds_id && !gs_id && !ps_id) || (entry = get_glsl_program_entry(priv, &key)))
     {
+        if (entry && entry->link_pending)
+            shader_glsl_complete_link(context_gl, priv, entry);
         ctx_data->glsl_program = entry;
         return;
     }
@@ -10364,6 +10720,7 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
     entry->cs.id = 0;
     entry->constant_version = 0;
     entry->shader_controlled_clip_distances = 0;
+    entry->link_pending = 0;
     entry->ps.np2_fixup_info = np2fixup_info;
     /* Add the hash table entry */
     add_glsl_program_entry(priv, entry);
@@ -10484,161 +10841,55 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
         list_add_head(ps_list, &entry->ps.shader_entry);
     }
 
-    /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
-
-    shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
-            vshader ? vshader->limits->constant_float : 0);
-    shader_glsl_init_ds_uniform_locations(gl_info, priv, program_id, &entry->ds);
-    shader_glsl_init_gs_uniform_locations(gl_info, priv, program_id, &entry->gs);
-    shader_glsl_init_ps_uniform_locations(gl_info, priv, program_id, &entry->ps,
-            pshader ? pshader->limits->constant_float : 0);
-    checkGLcall("find glsl program uniform locations");
+    /* Transform feedback varyings aren't part of the shader source, and
+     * therefore not part of the program cache key. */
+    if ((program_cache = shader_glsl_get_program_cache(gl_info, priv))
+            && (!gshader || !gshader->u.gs.so_desc))
+        program_cache_key = shader_glsl_get_program_cache_key(gl_info, program_id, &program_cache_key_size);
 
-    pre_rasterization_shader = gshader ? gshader : dshader ? dshader : vshader;
-    if (pre_rasterization_shader && pre_rasterization_shader->reg_maps.shader_version.major >= 4)
+    if (!program_cache_key || !shader_glsl_load_program_binary(gl_info, program_cache,
+            program_id, program_cache_key, program_cache_key_size))
     {
-        unsigned int clip_distance_count = wined3d_popcount(pre_rasterization_shader->reg_maps.clip_distance_mask);
-        entry->shader_controlled_clip_distances = 1;
-        entry->clip_distance_mask = wined3d_mask_from_size(clip_distance_count);
-    }
+        /* Link the program */
+        TRACE("Linking GLSL shader program %u.\n", program_id);
+        if (program_cache_key)
+            GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        GL_EXTCALL(glLinkProgram(program_id));
 
-    if (needs_legacy_glsl_syntax(gl_info))
-    {
-        if (pshader && pshader->reg_maps.shader_version.major >= 3
-                && pshader->u.ps.declared_in_count > vec4_varyings(3, gl_info))
+        /* With ARB_parallel_shader_compile the driver links in the
+         * background. Don't wait for it, but skip draws using the program
+         * until it's done. Transform feedback output can't be dropped. */
+        if (wined3d_settings.async_shader_compile == WINED3D_ASYNC_SHADER_COMPILE_SKIP_DRAW
+                && gl_info->supported[ARB_PARALLEL_SHADER_COMPILE] && (!gshader || !gshader->u.gs.so_desc))
         {
-            TRACE("Shader %d needs vertex color clamping disabled.\n", program_id);
-            entry->vs.vertex_color_clamp = GL_FALSE;
-        }
-        else
-        {
-            entry->vs.vertex_color_clamp = GL_FIXED_ONLY_ARB;
-        }
-    }
-    else
-    {
-        /* With core profile we never change vertex_color_clamp from
-         * GL_FIXED_ONLY_MODE (which is also the initial value) so we never call
-         * glClampColorARB(). */
-        entry->vs.vertex_color_clamp = GL_FIXED_ONLY_ARB;
-    }
-
-    /* Set the shader to allow uniform loading on it */
-    GL_EXTCALL(glUseProgram(program_id));
-    checkGLcall("glUseProgram");
+            GLint complete;
 
-    entry->constant_update_mask = 0;
-    if (vshader)
-    {
-        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_F;
-        if (vshader->reg_maps.integer_constants)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_I;
-        if (vshader->reg_maps.boolean_constants)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_B;
-        if (entry->vs.pos_fixup_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
-        if (entry->vs.base_vertex_id_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_BASE_VERTEX_ID;
-
-        shader_glsl_load_program_resources(context_gl, priv, program_id, vshader);
-    }
-    else
-    {
-        entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_MODELVIEW
-                | WINED3D_SHADER_CONST_FFP_PROJ;
-
-        for (i = 1; i < MAX_VERTEX_BLENDS; ++i)
-        {
-            if (entry->vs.modelview_matrix_location[i] != -1)
+            GL_EXTCALL(glGetProgramiv(program_id, GL_COMPLETION_STATUS_ARB, &complete));
+            if (!complete)
             {
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_VERTEXBLEND;
-                break;
+                TRACE("Deferring completion of GLSL shader program %u.\n", program_id);
+                entry->link_pending = 1;
+                entry->link_shaders[WINED3D_SHADER_TYPE_VERTEX] = vshader;
+                entry->link_shaders[WINED3D_SHADER_TYPE_HULL] = hshader;
+                entry->link_shaders[WINED3D_SHADER_TYPE_DOMAIN] = dshader;
+                entry->link_shaders[WINED3D_SHADER_TYPE_GEOMETRY] = gshader;
+                entry->link_shaders[WINED3D_SHADER_TYPE_PIXEL] = pshader;
+                entry->link_cache_key = program_cache_key;
+                entry->link_cache_key_size = program_cache_key_size;
+                QueryPerformanceCounter(&entry->link_start);
+                ++priv->async_links;
+                return;
             }
         }
 
-        for (i = 0; i < WINED3D_MAX_TEXTURES; ++i)
-        {
-            if (entry->vs.texture_matrix_location[i] != -1)
-            {
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_TEXMATRIX;
-                break;
-            }
-        }
-        if (entry->vs.material_ambient_location != -1 || entry->vs.material_diffuse_location != -1
-                || entry->vs.material_specular_location != -1
-                || entry->vs.material_emissive_location != -1
-                || entry->vs.material_shininess_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_MATERIAL;
-        if (entry->vs.light_ambient_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_LIGHTS;
+        shader_glsl_validate_link(gl_info, program_id);
+        if (program_cache_key)
+            shader_glsl_store_program_binary(gl_info, program_cache, program_id,
+                    program_cache_key, program_cache_key_size);
     }
-    if (entry->vs.clip_planes_location != -1)
-        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_CLIP_PLANES;
-    if (entry->vs.pointsize_min_location != -1)
-        entry->constant_update_mask |= WINED3D_SHADER_CONST_VS_POINTSIZE;
-
-    if (hshader)
-        shader_glsl_load_program_resources(context_gl, priv, program_id, hshader);
-
-    if (dshader)
-    {
-        if (entry->ds.pos_fixup_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
-
-        shader_glsl_load_program_resources(context_gl, priv, program_id, dshader);
-    }
-
-    if (gshader)
-    {
-        if (entry->gs.pos_fixup_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_POS_FIXUP;
-
-        shader_glsl_load_program_resources(context_gl, priv, program_id, gshader);
-    }
-
-    if (ps_id)
-    {
-        if (pshader)
-        {
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_F;
-            if (pshader->reg_maps.integer_constants)
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_I;
-            if (pshader->reg_maps.boolean_constants)
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_B;
-            if (entry->ps.ycorrection_location != -1)
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_Y_CORR;
-
-            shader_glsl_load_program_resources(context_gl, priv, program_id, pshader);
-            shader_glsl_load_images(gl_info, priv, program_id, &pshader->reg_maps);
-        }
-        else
-        {
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_PS;
-
-            shader_glsl_load_samplers(&context_gl->c, priv, program_id, NULL);
-        }
+    heap_free(program_cache_key);
 
-        for (i = 0; i < WINED3D_MAX_TEXTURES; ++i)
-        {
-            if (entry->ps.bumpenv_mat_location[i] != -1)
-            {
-                entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_BUMP_ENV;
-                break;
-            }
-        }
-
-        if (entry->ps.fog_color_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_FOG;
-        if (entry->ps.alpha_test_ref_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_ALPHA_TEST;
-        if (entry->ps.np2_fixup_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_PS_NP2_FIXUP;
-        if (entry->ps.color_key_location != -1)
-            entry->constant_update_mask |= WINED3D_SHADER_CONST_FFP_COLOR_KEY;
-    }
+    shader_glsl_init_program(context_gl, priv, entry, vshader, hshader, dshader, gshader, pshader);
 }
 
 static void shader_glsl_precompile(void *shader_priv, struct wined3d_shader *shader)
@@ -10661,18 +10912,28 @@ static void shader_glsl_select(void *shader_priv, struct wined3d_context *contex
     struct wined3d_context_gl *context_gl = wined3d_context_gl(context);
     struct glsl_context_data *ctx_data = context->shader_backend_data;
     const struct wined3d_gl_info *gl_info = context_gl->gl_info;
+    struct glsl_shader_prog_link *glsl_program, *prev_program;
     struct shader_glsl_priv *priv = shader_priv;
-    struct glsl_shader_prog_link *glsl_program;
     GLenum current_vertex_color_clamp;
     GLuint program_id, prev_id;
 
     priv->vertex_pipe->vp_enable(context, !use_vs(state));
     priv->fragment_pipe->fp_enable(context, !use_ps(state));
 
-    prev_id = ctx_data->glsl_program ? ctx_data->glsl_program->id : 0;
+    prev_program = ctx_data->glsl_program;
+    prev_id = prev_program ? prev_program->id : 0;
     set_glsl_shader_program(context_gl, state, priv, ctx_data);
     glsl_program = ctx_data->glsl_program;
 
+    if (glsl_program && glsl_program->link_pending)
+    {
+        TRACE("GLSL shader program %u is still being linked.\n", glsl_program->id);
+        ctx_data->glsl_program = prev_program;
+        context->shader_program_pending = 1;
+        ++priv->skipped_draws;
+        return;
+    }
+
     if (glsl_program)
     {
         program_id = glsl_program->id;
@@ -11102,8 +11363,15 @@ fail:
 static void shader_glsl_free(struct wined3d_device *device, struct wined3d_context *context)
 {
     struct shader_glsl_priv *priv = device->shader_priv;
+    LARGE_INTEGER freq;
+
+    if (priv->async_links && QueryPerformanceFrequency(&freq))
+        TRACE_(d3d_perf)("%u asynchronous program links, %u skipped draws, %s ms spent linking in the background.\n",
+                priv->async_links, priv->skipped_draws,
+                wine_dbgstr_longlong(priv->async_link_time * 1000 / freq.QuadPart));
 
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
+    wined3d_shader_cache_destroy(priv->program_cache);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
     heap_free(priv->stack);
@@ -11139,6 +11407,13 @@ static void shader_glsl_init_context_state(struct wined3d_context *context)
 
     gl_info->gl_ops.gl.p_glEnable(GL_PROGRAM_POINT_SIZE);
     checkGLcall("GL_PROGRAM_POINT_SIZE");
+
+    if (wined3d_settings.async_shader_compile && gl_info->supported[ARB_PARALLEL_SHADER_COMPILE])
+    {
+        /* Let the driver pick the number of compiler threads. */
+        GL_EXTCALL(glMaxShaderCompilerThreadsARB(~0u));
+        checkGLcall("glMaxShaderCompilerThreadsARB");
+    }
 }
 
 static unsigned int shader_glsl_get_shader_model(const struct wined3d_gl_info *gl_info)
@@ -0,0 +1,304 @@
+/*
+ * Persistent shader cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wined3d_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
+
+/* The cache stores one file per entry in the directory given by the
+ * "shader_cache_path" setting. Files are named after a hash of the key
+ * supplied by the caller, combined with a hash identifying the driver, so
+ * that a driver update invalidates them. The full key is stored in the entry
+ * and compared on load, so that hash collisions are only misses. When the
+ * total size exceeds the limit, the least recently used entries are evicted. */
+
+#define WINED3D_SHADER_CACHE_MAGIC      MAKEFOURCC('W','S','C','2')
+#define WINED3D_SHADER_CACHE_EXT        ".bin"
+
+struct wined3d_shader_cache_header
+{
+    uint32_t magic;
+    uint32_t tag;
+    uint64_t driver_hash;
+    uint32_t key_size;
+    uint32_t size;
+    uint32_t checksum;
+    uint32_t padding;
+};
+
+struct wined3d_shader_cache
+{
+    char *path;
+    uint64_t driver_hash;
+    uint64_t size;
+    uint64_t max_size;
+
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int stores;
+    unsigned int evictions;
+};
+
+struct wined3d_shader_cache_file
+{
+    char name[17 + sizeof(WINED3D_SHADER_CACHE_EXT)];
+    FILETIME time;
+    uint64_t size;
+};
+
+uint64_t wined3d_shader_cache_hash(const void *data, size_t size, uint64_t hash)
+{
+    const uint8_t *ptr = data;
+
+    /* 64-bit FNV-1a. */
+    while (size--)
+        hash = (hash ^ *ptr++) * 0x100000001b3ull;
+    return hash;
+}
+
+static void shader_cache_get_file_name(const struct wined3d_shader_cache *cache,
+        const void *key, size_t key_size, char *buffer, size_t size)
+{
+    uint64_t hash = wined3d_shader_cache_hash(key, key_size, cache->driver_hash);
+
+    snprintf(buffer, size, "%s%08x%08x%s", cache->path, (unsigned int)(hash >> 32),
+            (unsigned int)hash, WINED3D_SHADER_CACHE_EXT);
+}
+
+static int __cdecl shader_cache_file_compare(const void *a, const void *b)
+{
+    const struct wined3d_shader_cache_file *f1 = a, *f2 = b;
+
+    return CompareFileTime(&f1->time, &f2->time);
+}
+
+static uint64_t shader_cache_enum_files(const struct wined3d_shader_cache *cache,
+        struct wined3d_shader_cache_file **files, SIZE_T *count)
+{
+    struct wined3d_shader_cache_file *file;
+    SIZE_T files_size = 0;
+    WIN32_FIND_DATAA data;
+    char pattern[MAX_PATH];
+    uint64_t total = 0;
+    HANDLE handle;
+
+    if (files)
+    {
+        *files = NULL;
+        *count = 0;
+    }
+
+    snprintf(pattern, sizeof(pattern), "%s*%s", cache->path, WINED3D_SHADER_CACHE_EXT);
+    if ((handle = FindFirstFileA(pattern, &data)) == INVALID_HANDLE_VALUE)
+        return 0;
+
+    do
+    {
+        uint64_t size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+
+        total += size;
+        if (!files || strlen(data.cFileName) >= ARRAY_SIZE(file->name))
+            continue;
+        if (!wined3d_array_reserve((void **)files, &files_size, *count + 1, sizeof(**files)))
+            break;
+        file = &(*files)[(*count)++];
+        strcpy(file->name, data.cFileName);
+        file->time = data.ftLastWriteTime;
+        file->size = size;
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+
+    return total;
+}
+
+/* Delete the least recently used entries, until the cache is reduced to 3/4
+ * of its maximum size. */
+static void shader_cache_evict(struct wined3d_shader_cache *cache)
+{
+    struct wined3d_shader_cache_file *files;
+    char name[MAX_PATH];
+    SIZE_T count, i;
+
+    cache->size = shader_cache_enum_files(cache, &files, &count);
+    qsort(files, count, sizeof(*files), shader_cache_file_compare);
+
+    for (i = 0; i < count && cache->size > cache->max_size / 4 * 3; ++i)
+    {
+        snprintf(name, sizeof(name), "%s%s", cache->path, files[i].name);
+        if (!DeleteFileA(name))
+            continue;
+        cache->size -= files[i].size;
+        ++cache->evictions;
+    }
+
+    heap_free(files);
+}
+
+struct wined3d_shader_cache *wined3d_shader_cache_create(const char *driver_id)
+{
+    struct wined3d_shader_cache *cache;
+    size_t len;
+
+    if (!wined3d_settings.shader_cache_path)
+        return NULL;
+
+    if (!(cache = heap_alloc_zero(sizeof(*cache))))
+        return NULL;
+
+    len = strlen(wined3d_settings.shader_cache_path);
+    if (!(cache->path = heap_alloc(len + 2)))
+    {
+        heap_free(cache);
+        return NULL;
+    }
+    memcpy(cache->path, wined3d_settings.shader_cache_path, len);
+    if (len && cache->path[len - 1] != '\\' && cache->path[len - 1] != '/')
+        cache->path[len++] = '\\';
+    cache->path[len] = 0;
+
+    CreateDirectoryA(cache->path, NULL);
+
+    cache->driver_hash = wined3d_shader_cache_hash(driver_id, strlen(driver_id), WINED3D_SHADER_CACHE_HASH_INIT);
+    cache->max_size = (uint64_t)wined3d_settings.shader_cache_size * 1024 * 1024;
+    cache->size = shader_cache_enum_files(cache, NULL, NULL);
+
+    TRACE("Using shader cache %s, size %s, driver %s.\n", debugstr_a(cache->path),
+            wine_dbgstr_longlong(cache->size), debugstr_a(driver_id));
+
+    return cache;
+}
+
+void wined3d_shader_cache_destroy(struct wined3d_shader_cache *cache)
+{
+    if (!cache)
+        return;
+
+    TRACE_(d3d_perf)("Shader cache %p: %u hits, %u misses, %u stores, %u evictions, size %s.\n",
+            cache, cache->hits, cache->misses, cache->stores, cache->evictions,
+            wine_dbgstr_longlong(cache->size));
+
+    heap_free(cache->path);
+    heap_free(cache);
+}
+
+void *wined3d_shader_cache_load(struct wined3d_shader_cache *cache, const void *key, size_t key_size,
+        uint32_t *tag, size_t *size)
+{
+    struct wined3d_shader_cache_header header;
+    void *data, *stored_key = NULL;
+    char name[MAX_PATH];
+    FILETIME now;
+    HANDLE file;
+    DWORD read;
+
+    shader_cache_get_file_name(cache, key, key_size, name, sizeof(name));
+    if ((file = CreateFileA(name, GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        ++cache->misses;
+        return NULL;
+    }
+
+    if (!ReadFile(file, &header, sizeof(header), &read, NULL) || read != sizeof(header)
+            || header.magic != WINED3D_SHADER_CACHE_MAGIC || header.key_size != key_size
+            || header.driver_hash != cache->driver_hash
+            || !(stored_key = heap_alloc(key_size))
+            || !ReadFile(file, stored_key, key_size, &read, NULL) || read != key_size
+            || memcmp(stored_key, key, key_size))
+    {
+        TRACE("Invalid or mismatching shader cache entry %s.\n", debugstr_a(name));
+        heap_free(stored_key);
+        CloseHandle(file);
+        ++cache->misses;
+        return NULL;
+    }
+    heap_free(stored_key);
+
+    if (!(data = heap_alloc(header.size)) || !ReadFile(file, data, header.size, &read, NULL) || read != header.size
+            || (uint32_t)wined3d_shader_cache_hash(data, header.size, WINED3D_SHADER_CACHE_HASH_INIT)
+            != header.checksum)
+    {
+        WARN("Corrupted shader cache entry %s.\n", debugstr_a(name));
+        heap_free(data);
+        CloseHandle(file);
+        ++cache->misses;
+        return NULL;
+    }
+
+    /* Keep track of the last use, for eviction. */
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, NULL, NULL, &now);
+    CloseHandle(file);
+
+    ++cache->hits;
+    *tag = header.tag;
+    *size = header.size;
+    return data;
+}
+
+void wined3d_shader_cache_store(struct wined3d_shader_cache *cache, const void *key, size_t key_size,
+        uint32_t tag, const void *data, size_t size)
+{
+    struct wined3d_shader_cache_header header;
+    char name[MAX_PATH], tmp_name[MAX_PATH + 4];
+    DWORD written;
+    HANDLE file;
+    BOOL ret;
+
+    if (size > UINT32_MAX || key_size > UINT32_MAX || sizeof(header) + key_size + size > cache->max_size)
+        return;
+
+    if (cache->size + sizeof(header) + key_size + size > cache->max_size)
+        shader_cache_evict(cache);
+
+    header.magic = WINED3D_SHADER_CACHE_MAGIC;
+    header.tag = tag;
+    header.driver_hash = cache->driver_hash;
+    header.key_size = key_size;
+    header.size = size;
+    header.checksum = wined3d_shader_cache_hash(data, size, WINED3D_SHADER_CACHE_HASH_INIT);
+    header.padding = 0;
+
+    /* Write to a temporary file first, so that other processes never see a
+     * partially written entry. */
+    shader_cache_get_file_name(cache, key, key_size, name, sizeof(name));
+    snprintf(tmp_name, sizeof(tmp_name), "%s.%04x", name, (unsigned int)GetCurrentProcessId() & 0xffff);
+    if ((file = CreateFileA(tmp_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create shader cache entry %s.\n", debugstr_a(tmp_name));
+        return;
+    }
+    ret = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header)
+            && WriteFile(file, key, key_size, &written, NULL) && written == key_size
+            && WriteFile(file, data, size, &written, NULL) && written == size;
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExA(tmp_name, name, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write shader cache entry %s.\n", debugstr_a(name));
+        DeleteFileA(tmp_name);
+        return;
+    }
+
+    cache->size += sizeof(header) + key_size + size;
+    ++cache->stores;
+}
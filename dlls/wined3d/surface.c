@@ -26,6 +26,10 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
@@ -45,64 +49,35 @@ static void get_color_masks(const struct wined3d_format *format, uint32_t *masks
 /* See also float_16_to_32() in wined3d_private.h */
 static inline unsigned short float_32_to_16(const float *in)
 {
-    int exp = 0;
-    float tmp = fabsf(*in);
-    unsigned int mantissa;
-    unsigned short ret;
+    unsigned int bits, exp, mantissa;
+    unsigned short sign;
+    int e;
 
-    /* Deal with special numbers */
-    if (*in == 0.0f)
-        return 0x0000;
-    if (isnan(*in))
-        return 0x7c01;
-    if (isinf(*in))
-        return (*in < 0.0f ? 0xfc00 : 0x7c00);
-
-    if (tmp < (float)(1u << 10))
-    {
-        do
-        {
-            tmp = tmp * 2.0f;
-            exp--;
-        } while (tmp < (float)(1u << 10));
-    }
-    else if (tmp >= (float)(1u << 11))
-    {
-        do
-        {
-            tmp /= 2.0f;
-            exp++;
-        } while (tmp >= (float)(1u << 11));
-    }
+    memcpy(&bits, in, sizeof(bits));
+    sign = (bits >> 16) & 0x8000;
+    exp = (bits >> 23) & 0xff;
+    bits &= 0x7fffff;
 
-    mantissa = (unsigned int)tmp;
-    if (tmp - mantissa >= 0.5f)
-        ++mantissa; /* Round to nearest, away from zero. */
-
-    exp += 10;  /* Normalize the mantissa. */
-    exp += 15;  /* Exponent is encoded with excess 15. */
-
-    if (exp > 30) /* too big */
-    {
-        ret = 0x7c00; /* INF */
-    }
-    else if (exp <= 0)
-    {
-        /* exp == 0: Non-normalized mantissa. Returns 0x0000 (=0.0) for too small numbers. */
-        while (exp <= 0)
-        {
-            mantissa = mantissa >> 1;
-            ++exp;
-        }
-        ret = mantissa & 0x3ff;
-    }
-    else
+    /* Deal with special numbers */
+    if (exp == 0xff)
+        return bits ? 0x7c01 : sign | 0x7c00;
+    if (!exp) /* Zero, and numbers too small for a half float. */
+        return bits ? sign : 0x0000;
+
+    /* Round the 24-bit significand to 11 bits, to nearest, away from zero.
+     * Note that a carry out of the mantissa is dropped rather than
+     * incrementing the exponent. */
+    mantissa = ((bits | 0x800000) + 0x1000) >> 13;
+    e = (int)exp - 127 + 15;  /* Exponent is encoded with excess 15. */
+
+    if (e > 30) /* too big */
+        return sign | 0x7c00; /* INF */
+    if (e <= 0)
     {
-        ret = (exp << 10) | (mantissa & 0x3ff);
+        /* e == 0: Non-normalized mantissa. Returns 0x0000 (=0.0) for too small numbers. */
+        return sign | (e > -12 ? (mantissa >> (1 - e)) & 0x3ff : 0);
     }
-
-    ret |= ((*in < 0.0f ? 1 : 0) << 15); /* Add the sign */
-    return ret;
+    return sign | (e << 10) | (mantissa & 0x3ff);
 }
 
 static void convert_r32_float_r16_float(const BYTE *src, BYTE *dst,
@@ -154,7 +129,30 @@ static void convert_r5g6b5_x8r8g8b8(const BYTE *src, BYTE *dst,
     {
         const WORD *src_line = (const WORD *)(src + y * pitch_in);
         DWORD *dst_line = (DWORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+
+        x = 0;
+#ifdef __SSE2__
+        /* (v * 527 + 23) >> 6 and (v * 259 + 33) >> 6 give the same results
+         * as the 5 and 6 bit lookup tables. */
+        for (; x + 8 <= w; x += 8)
+        {
+            __m128i pixel = _mm_loadu_si128((const __m128i *)&src_line[x]);
+            __m128i r, g, b, bg, ra;
+
+            r = _mm_srli_epi16(pixel, 11);
+            g = _mm_and_si128(_mm_srli_epi16(pixel, 5), _mm_set1_epi16(0x3f));
+            b = _mm_and_si128(pixel, _mm_set1_epi16(0x1f));
+            r = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(527)), _mm_set1_epi16(23)), 6);
+            g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, _mm_set1_epi16(259)), _mm_set1_epi16(33)), 6);
+            b = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(527)), _mm_set1_epi16(23)), 6);
+
+            bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+            ra = _mm_or_si128(r, _mm_set1_epi16(0xff00));
+            _mm_storeu_si128((__m128i *)&dst_line[x], _mm_unpacklo_epi16(bg, ra));
+            _mm_storeu_si128((__m128i *)&dst_line[x + 4], _mm_unpackhi_epi16(bg, ra));
+        }
+#endif
+        for (; x < w; ++x)
         {
             WORD pixel = src_line[x];
             dst_line[x] = 0xff000000u
@@ -179,7 +177,15 @@ static void convert_a8r8g8b8_x8r8g8b8(const BYTE *src, BYTE *dst,
         const DWORD *src_line = (const DWORD *)(src + y * pitch_in);
         DWORD *dst_line = (DWORD *)(dst + y * pitch_out);
 
-        for (x = 0; x < w; ++x)
+        x = 0;
+#ifdef __SSE2__
+        for (; x + 4 <= w; x += 4)
+        {
+            __m128i pixel = _mm_loadu_si128((const __m128i *)&src_line[x]);
+            _mm_storeu_si128((__m128i *)&dst_line[x], _mm_or_si128(pixel, _mm_set1_epi32(0xff000000)));
+        }
+#endif
+        for (; x < w; ++x)
         {
             dst_line[x] = 0xff000000 | (src_line[x] & 0xffffff);
         }
@@ -191,6 +197,63 @@ static inline BYTE cliptobyte(int x)
     return (BYTE)((x < 0) ? 0 : ((x > 255) ? 255 : x));
 }
 
+#ifdef __SSE2__
+/* Shift the 32-bit intermediate values and clamp them to 0-255, like
+ * cliptobyte(), returning 16-bit values. */
+static inline __m128i yuy2_clamp_sse2(__m128i lo, __m128i hi)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    lo = _mm_srai_epi32(lo, 8);
+    hi = _mm_srai_epi32(hi, 8);
+    return _mm_unpacklo_epi8(_mm_packus_epi16(_mm_packs_epi32(lo, hi), zero), zero);
+}
+
+/* Convert 8 YUY2 pixels to 16-bit R, G and B values, clamped to 0-255, using
+ * the same formulas as the C code below. */
+static inline void yuy2_to_rgb_sse2(const BYTE *src, __m128i *r, __m128i *g, __m128i *b)
+{
+    const __m128i coeff_r = _mm_setr_epi16(298, 409, 298, 409, 298, 409, 298, 409);
+    const __m128i coeff_gu = _mm_setr_epi16(298, -100, 298, -100, 298, -100, 298, -100);
+    const __m128i coeff_gv = _mm_setr_epi16(-208, 128, -208, 128, -208, 128, -208, 128);
+    const __m128i coeff_b = _mm_setr_epi16(298, 516, 298, 516, 298, 516, 298, 516);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i pixels, lo, hi, y, uv, u, v, yu, yv, round;
+    __m128i r_lo, r_hi, g_lo, g_hi, b_lo, b_hi;
+
+    /* Y0 U0 Y1 V0 Y2 U1 Y3 V1 ... */
+    pixels = _mm_loadu_si128((const __m128i *)src);
+    lo = _mm_unpacklo_epi8(pixels, zero);
+    hi = _mm_unpackhi_epi8(pixels, zero);
+    y = _mm_packs_epi32(_mm_and_si128(lo, _mm_set1_epi32(0xffff)), _mm_and_si128(hi, _mm_set1_epi32(0xffff)));
+    uv = _mm_packs_epi32(_mm_srli_epi32(lo, 16), _mm_srli_epi32(hi, 16));
+    y = _mm_sub_epi16(y, _mm_set1_epi16(16));
+    uv = _mm_sub_epi16(uv, _mm_set1_epi16(128));
+    /* U0 U0 U1 U1 ... and V0 V0 V1 V1 ..., matching the Y values. */
+    u = _mm_or_si128(_mm_and_si128(uv, _mm_set1_epi32(0xffff)), _mm_slli_epi32(uv, 16));
+    v = _mm_or_si128(_mm_srli_epi32(uv, 16), _mm_andnot_si128(_mm_set1_epi32(0xffff), uv));
+
+    round = _mm_set1_epi32(128);
+    yv = _mm_unpacklo_epi16(y, v);
+    r_lo = _mm_add_epi32(_mm_madd_epi16(yv, coeff_r), round);
+    yu = _mm_unpacklo_epi16(y, u);
+    g_lo = _mm_add_epi32(_mm_madd_epi16(yu, coeff_gu),
+            _mm_madd_epi16(_mm_unpacklo_epi16(v, _mm_set1_epi16(1)), coeff_gv));
+    b_lo = _mm_add_epi32(_mm_madd_epi16(yu, coeff_b), round);
+
+    yv = _mm_unpackhi_epi16(y, v);
+    r_hi = _mm_add_epi32(_mm_madd_epi16(yv, coeff_r), round);
+    yu = _mm_unpackhi_epi16(y, u);
+    g_hi = _mm_add_epi32(_mm_madd_epi16(yu, coeff_gu),
+            _mm_madd_epi16(_mm_unpackhi_epi16(v, _mm_set1_epi16(1)), coeff_gv));
+    b_hi = _mm_add_epi32(_mm_madd_epi16(yu, coeff_b), round);
+
+    *r = yuy2_clamp_sse2(r_lo, r_hi);
+    *g = yuy2_clamp_sse2(g_lo, g_hi);
+    *b = yuy2_clamp_sse2(b_lo, b_hi);
+}
+#endif
+
 static void convert_yuy2_x8r8g8b8(const BYTE *src, BYTE *dst,
         DWORD pitch_in, DWORD pitch_out, unsigned int w, unsigned int h)
 {
@@ -203,7 +266,22 @@ static void convert_yuy2_x8r8g8b8(const BYTE *src, BYTE *dst,
     {
         const BYTE *src_line = src + y * pitch_in;
         DWORD *dst_line = (DWORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+
+        x = 0;
+#ifdef __SSE2__
+        for (; x + 8 <= w; x += 8)
+        {
+            __m128i r, g, b, bg, ra;
+
+            yuy2_to_rgb_sse2(src_line, &r, &g, &b);
+            bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+            ra = _mm_or_si128(r, _mm_set1_epi16(0xff00));
+            _mm_storeu_si128((__m128i *)&dst_line[x], _mm_unpacklo_epi16(bg, ra));
+            _mm_storeu_si128((__m128i *)&dst_line[x + 4], _mm_unpackhi_epi16(bg, ra));
+            src_line += 16;
+        }
+#endif
+        for (; x < w; ++x)
         {
             /* YUV to RGB conversion formulas from http://en.wikipedia.org/wiki/YUV:
              *     C = Y - 16; D = U - 128; E = V - 128;
@@ -245,7 +323,22 @@ static void convert_yuy2_r5g6b5(const BYTE *src, BYTE *dst,
     {
         const BYTE *src_line = src + y * pitch_in;
         WORD *dst_line = (WORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+
+        x = 0;
+#ifdef __SSE2__
+        for (; x + 8 <= w; x += 8)
+        {
+            __m128i r, g, b;
+
+            yuy2_to_rgb_sse2(src_line, &r, &g, &b);
+            r = _mm_slli_epi16(_mm_srli_epi16(r, 3), 11);
+            g = _mm_slli_epi16(_mm_srli_epi16(g, 2), 5);
+            b = _mm_srli_epi16(b, 3);
+            _mm_storeu_si128((__m128i *)&dst_line[x], _mm_or_si128(_mm_or_si128(r, g), b));
+            src_line += 16;
+        }
+#endif
+        for (; x < w; ++x)
         {
             /* YUV to RGB conversion formulas from http://en.wikipedia.org/wiki/YUV:
              *     C = Y - 16; D = U - 128; E = V - 128;
@@ -605,6 +698,48 @@ static void cpu_blitter_destroy(struct wined3d_blitter *blitter, struct wined3d_
     heap_free(blitter);
 }
 
+#ifdef __SSE2__
+/* SSE2 only has signed comparisons; flip the sign bits to compare unsigned values. */
+static inline __m128i colour_key_out_of_range_sse2(__m128i value, __m128i low, __m128i high)
+{
+    value = _mm_xor_si128(value, _mm_set1_epi32(0x80000000));
+    return _mm_or_si128(_mm_cmplt_epi32(value, low), _mm_cmpgt_epi32(value, high));
+}
+
+/* Colour keyed copy of a row of 32-bit pixels, without stretching or mirroring. */
+static void surface_cpu_blt_colour_key_row_sse2(const DWORD *src, DWORD *dst, unsigned int width,
+        DWORD keymask, DWORD keylow, DWORD keyhigh, DWORD destkeymask, DWORD destkeylow, DWORD destkeyhigh)
+{
+    const __m128i sign = _mm_set1_epi32(0x80000000);
+    __m128i low, high, dst_low, dst_high, src_mask, dst_mask, s, d, copy;
+    unsigned int x;
+
+    low = _mm_xor_si128(_mm_set1_epi32(keylow), sign);
+    high = _mm_xor_si128(_mm_set1_epi32(keyhigh), sign);
+    dst_low = _mm_xor_si128(_mm_set1_epi32(destkeylow), sign);
+    dst_high = _mm_xor_si128(_mm_set1_epi32(destkeyhigh), sign);
+    src_mask = _mm_set1_epi32(keymask);
+    dst_mask = _mm_set1_epi32(destkeymask);
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        s = _mm_loadu_si128((const __m128i *)&src[x]);
+        d = _mm_loadu_si128((const __m128i *)&dst[x]);
+        copy = _mm_andnot_si128(colour_key_out_of_range_sse2(_mm_and_si128(d, dst_mask), dst_low, dst_high),
+                colour_key_out_of_range_sse2(_mm_and_si128(s, src_mask), low, high));
+        d = _mm_or_si128(_mm_and_si128(copy, s), _mm_andnot_si128(copy, d));
+        _mm_storeu_si128((__m128i *)&dst[x], d);
+    }
+
+    for (; x < width; ++x)
+    {
+        if (((src[x] & keymask) < keylow || (src[x] & keymask) > keyhigh)
+                && ((dst[x] & destkeymask) >= destkeylow && (dst[x] & destkeymask) <= destkeyhigh))
+            dst[x] = src[x];
+    }
+}
+#endif
+
 static HRESULT surface_cpu_blt_compressed(const BYTE *src_data, BYTE *dst_data,
         UINT src_pitch, UINT dst_pitch, UINT update_w, UINT update_h,
         const struct wined3d_format *format, DWORD flags, const struct wined3d_blt_fx *fx)
@@ -1147,6 +1282,23 @@ do { \
                 COPY_COLORKEY_FX(WORD);
                 break;
             case 4:
+#ifdef __SSE2__
+                /* The vector path reads ahead of the scalar one, so only use
+                 * it when the source and destination can't overlap. */
+                if (xinc == 1 << 16 && dstxinc == 4 && !same_sub_resource)
+                {
+                    BYTE *d = dbuf;
+
+                    for (y = sy = 0; y < dst_height; ++y, sy += yinc)
+                    {
+                        surface_cpu_blt_colour_key_row_sse2((const DWORD *)(sbase + (sy >> 16) * src_map.row_pitch),
+                                (DWORD *)d, dst_width, keymask, keylow, keyhigh,
+                                destkeymask, destkeylow, destkeyhigh);
+                        d += dstyinc;
+                    }
+                    break;
+                }
+#endif
                 COPY_COLORKEY_FX(DWORD);
                 break;
             case 3:
@@ -122,6 +122,8 @@ struct wined3d_settings wined3d_settings =
     .max_sm_cs = UINT_MAX,
     .renderer = WINED3D_RENDERER_AUTO,
     .shader_backend = WINED3D_SHADER_BACKEND_AUTO,
+    .shader_cache_size = 256,
+    .async_shader_compile = WINED3D_ASYNC_SHADER_COMPILE_DISABLE,
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -454,6 +456,19 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Forcing all constant buffers to be write-mappable.\n");
             wined3d_settings.cb_access_map_w = TRUE;
         }
+        if (!get_config_key(hkey, appkey, env, "shader_cache_path", buffer, size) && *buffer)
+        {
+            size_t len = strlen(buffer) + 1;
+
+            if (!(wined3d_settings.shader_cache_path = heap_alloc(len)))
+                ERR("Failed to allocate shader cache path memory.\n");
+            else
+                memcpy(wined3d_settings.shader_cache_path, buffer, len);
+        }
+        if (!get_config_key_dword(hkey, appkey, env, "shader_cache_size", &wined3d_settings.shader_cache_size))
+            TRACE("Limiting the shader cache size to %u MiB.\n", wined3d_settings.shader_cache_size);
+        if (!get_config_key_dword(hkey, appkey, env, "async_shader_compile", &wined3d_settings.async_shader_compile))
+            ERR_(winediag)("Setting asynchronous shader compilation to %#x.\n", wined3d_settings.async_shader_compile);
     }
 
     if (appkey) RegCloseKey( appkey );
@@ -494,6 +509,7 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     heap_free(swapchain_state_table.hooks);
 
     heap_free(wined3d_settings.logo);
+    heap_free(wined3d_settings.shader_cache_path);
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
     DeleteCriticalSection(&wined3d_command_cs);
@@ -446,8 +446,12 @@ enum wined3d_shader_backend
     WINED3D_SHADER_BACKEND_NONE,
 };
 
-#define WINED3D_CSMT_ENABLE    0x00000001
-#define WINED3D_CSMT_SERIALIZE 0x00000002
+#define WINED3D_CSMT_ENABLE     0x00000001
+#define WINED3D_CSMT_SERIALIZE  0x00000002
+#define WINED3D_CSMT_POWER_SAVE 0x00000004
+
+#define WINED3D_ASYNC_SHADER_COMPILE_DISABLE   0
+#define WINED3D_ASYNC_SHADER_COMPILE_SKIP_DRAW 1
 
 /* NOTE: When adding fields to this structure, make sure to update the default
  * values in wined3d_main.c as well. */
@@ -474,10 +478,25 @@ struct wined3d_settings
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
     BOOL cb_access_map_w;
+    char *shader_cache_path;
+    unsigned int shader_cache_size;
+    unsigned int async_shader_compile;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
 
+#define WINED3D_SHADER_CACHE_HASH_INIT 0xcbf29ce484222325ull
+
+struct wined3d_shader_cache;
+
+struct wined3d_shader_cache *wined3d_shader_cache_create(const char *driver_id) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_destroy(struct wined3d_shader_cache *cache) DECLSPEC_HIDDEN;
+uint64_t wined3d_shader_cache_hash(const void *data, size_t size, uint64_t hash) DECLSPEC_HIDDEN;
+void *wined3d_shader_cache_load(struct wined3d_shader_cache *cache, const void *key, size_t key_size,
+        uint32_t *tag, size_t *size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_store(struct wined3d_shader_cache *cache, const void *key, size_t key_size,
+        uint32_t tag, const void *data, size_t size) DECLSPEC_HIDDEN;
+
 enum wined3d_shader_byte_code_format
 {
     WINED3D_SHADER_BYTE_CODE_FORMAT_SM1,
@@ -2183,7 +2202,8 @@ struct wined3d_context
     DWORD destroy_delayed : 1;
     DWORD clip_distance_mask : 8; /* WINED3D_MAX_CLIP_DISTANCES, 8 */
     DWORD namedArraysLoaded : 1;
-    DWORD padding : 13;
+    DWORD shader_program_pending : 1;
+    DWORD padding : 12;
 
     DWORD constant_update_mask;
     DWORD numbered_array_mask;
@@ -4899,6 +4919,8 @@ enum wined3d_push_constants
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
 #define WINED3D_CS_QUEUE_SIZE           0x400000u
 #define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_MIN_SPIN_COUNT       1000u
+#define WINED3D_CS_PRODUCER_SPIN_COUNT  10000u
 #define WINED3D_CS_QUEUE_MASK           (WINED3D_CS_QUEUE_SIZE - 1)
 
 struct wined3d_cs_queue
@@ -4932,6 +4954,16 @@ struct wined3d_device_context
     struct wined3d_state *state;
 };
 
+struct wined3d_cs_stats
+{
+    BOOL enabled;
+    LARGE_INTEGER frequency, start;
+    ULONG packet_count;  /* only used by the CS thread */
+    LONG max_occupancy;
+    LONGLONG require_space_time;
+    LONGLONG finish_time;
+};
+
 struct wined3d_cs
 {
     struct wined3d_device_context c;
@@ -4948,9 +4980,13 @@ struct wined3d_cs
     struct list query_poll_list;
     BOOL queries_flushed;
 
-    HANDLE event;
-    BOOL waiting_for_event;
+    LONG waiting_for_work;
+    LONG waiting_producers;
+    unsigned int spin_limit, max_spin_limit;
+    unsigned int producer_spin_limit;
     LONG pending_presents;
+
+    struct wined3d_cs_stats stats;
 };
 
 static inline void wined3d_device_context_lock(struct wined3d_device_context *context)
@@ -4968,6 +5004,8 @@ static inline void wined3d_device_context_unlock(struct wined3d_device_context *
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
         const enum wined3d_feature_level *levels, unsigned int level_count) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
+void wined3d_cs_wait_progress(struct wined3d_cs *cs, unsigned int *spin_count,
+        const volatile ULONG *addr, ULONG value) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy_object(struct wined3d_cs *cs,
         void (*callback)(void *object), void *object) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_add_dirty_texture_region(struct wined3d_cs *cs,
@@ -5100,8 +5138,9 @@ C_ASSERT(WINED3D_CS_QUEUE_SIZE < UINT_MAX / 4);
 
 static inline void wined3d_resource_wait_idle(const struct wined3d_resource *resource)
 {
-    const struct wined3d_cs *cs = resource->device->cs;
+    struct wined3d_cs *cs = resource->device->cs;
     ULONG access_time, tail, head;
+    unsigned int spin_count = 0;
 
     if (!cs->thread || cs->thread_id == GetCurrentThreadId())
         return;
@@ -5140,7 +5179,7 @@ static inline void wined3d_resource_wait_idle(const struct wined3d_resource *res
         if (!wined3d_ge_wrap(access_time, tail) && access_time != tail)
             break;
 
-        YieldProcessor();
+        wined3d_cs_wait_progress(cs, &spin_count, &cs->queue[WINED3D_CS_QUEUE_DEFAULT].tail, tail);
     }
 }
 
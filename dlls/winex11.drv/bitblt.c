@@ -49,6 +49,7 @@
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(bitblt);
+WINE_DECLARE_DEBUG_CHANNEL(fps);
 
 
 #define DST 0   /* Destination drawable */
@@ -1567,6 +1568,9 @@ DWORD get_pixmap_image( Pixmap pixmap, int width, int height, const XVisualInfo
 }
 
 
+/* maximum number of separate rectangles tracked between two flushes */
+#define MAX_DAMAGE_RECTS 16
+
 struct x11drv_window_surface
 {
     struct window_surface header;
@@ -1574,6 +1578,8 @@ struct x11drv_window_surface
     GC                    gc;
     XImage               *image;
     RECT                  bounds;
+    RECT                  damage[MAX_DAMAGE_RECTS];
+    UINT                  damage_count;
     BOOL                  byteswap;
     BOOL                  is_argb;
     DWORD                 alpha_bits;
@@ -1584,6 +1590,8 @@ struct x11drv_window_surface
     XShmSegmentInfo       shminfo;
 #endif
     pthread_mutex_t       mutex;
+    ULONGLONG             bytes_flushed;
+    DWORD                 stats_time;
     BITMAPINFO            info;   /* variable size, must be last */
 };
 
@@ -1824,6 +1832,70 @@ failed:
 }
 #endif /* HAVE_LIBXXSHM */
 
+static inline int get_rect_area( const RECT *rect )
+{
+    return (rect->right - rect->left) * (rect->bottom - rect->top);
+}
+
+/***********************************************************************
+ *           add_damage_rect
+ *
+ * Add a rectangle to the surface damage list. It gets merged with an existing
+ * entry when their union doesn't cover much more than the two rectangles, so
+ * that overlapping or neighbouring updates are pushed together, while distant
+ * ones are pushed separately instead of as one large bounding rectangle.
+ */
+static void add_damage_rect( struct x11drv_window_surface *surface, const RECT *rect )
+{
+    RECT rc = *rect, tmp;
+    UINT i, best;
+    int waste, best_waste;
+
+    for (;;)
+    {
+        best = ~0u;
+        best_waste = INT_MAX;
+        for (i = 0; i < surface->damage_count; i++)
+        {
+            UnionRect( &tmp, &surface->damage[i], &rc );
+            if (EqualRect( &tmp, &surface->damage[i] )) return;  /* already covered */
+            waste = get_rect_area( &tmp ) - get_rect_area( &surface->damage[i] ) - get_rect_area( &rc );
+            if (waste > 4096 && waste > (get_rect_area( &surface->damage[i] ) + get_rect_area( &rc )) / 4)
+            {
+                /* only merge if we ran out of entries */
+                if (surface->damage_count < MAX_DAMAGE_RECTS) continue;
+            }
+            if (waste < best_waste)
+            {
+                best = i;
+                best_waste = waste;
+            }
+        }
+        if (best == ~0u) break;
+        /* the merged rectangle may now be worth merging with another entry */
+        UnionRect( &rc, &surface->damage[best], &rc );
+        surface->damage[best] = surface->damage[--surface->damage_count];
+    }
+    surface->damage[surface->damage_count++] = rc;
+}
+
+/***********************************************************************
+ *           flush_bounds
+ *
+ * Move the bounds accumulated by the drawing code to the damage list. This is
+ * only done when flushing, since win32u starts its flush timer when it finds
+ * the bounds empty.
+ */
+static void flush_bounds( struct x11drv_window_surface *surface )
+{
+    RECT rect;
+
+    SetRect( &rect, 0, 0, surface->header.rect.right - surface->header.rect.left,
+             surface->header.rect.bottom - surface->header.rect.top );
+    if (IntersectRect( &rect, &rect, &surface->bounds )) add_damage_rect( surface, &rect );
+    reset_bounds( &surface->bounds );
+}
+
 /***********************************************************************
  *           x11drv_surface_lock
  */
@@ -1896,6 +1968,43 @@ static void x11drv_surface_set_region( struct window_surface *window_surface, HR
     window_surface->funcs->unlock( window_surface );
 }
 
+/***********************************************************************
+ *           put_surface_rect
+ */
+static void put_surface_rect( struct x11drv_window_surface *surface, const RECT *rect )
+{
+    unsigned char *dst = (unsigned char *)surface->image->data;
+    int x, y;
+
+    if (surface->bits == dst && surface->alpha_bits)
+    {
+        int stride = surface->image->bytes_per_line / sizeof(ULONG);
+        ULONG *ptr = (ULONG *)dst + rect->top * stride;
+
+        for (y = rect->top; y < rect->bottom; y++, ptr += stride)
+            for (x = rect->left; x < rect->right; x++)
+                ptr[x] |= surface->alpha_bits;
+    }
+
+#ifdef HAVE_LIBXXSHM
+    if (surface->shminfo.shmid != -1)
+        XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                      rect->left, rect->top,
+                      surface->header.rect.left + rect->left,
+                      surface->header.rect.top + rect->top,
+                      rect->right - rect->left, rect->bottom - rect->top, False );
+    else
+#endif
+    XPutImage( gdi_display, surface->window, surface->gc, surface->image,
+               rect->left, rect->top,
+               surface->header.rect.left + rect->left,
+               surface->header.rect.top + rect->top,
+               rect->right - rect->left, rect->bottom - rect->top );
+
+    surface->bytes_flushed += (ULONGLONG)(rect->right - rect->left) * (rect->bottom - rect->top) *
+                              surface->image->bits_per_pixel / 8;
+}
+
 /***********************************************************************
  *           x11drv_surface_flush
  */
@@ -1904,19 +2013,16 @@ static void x11drv_surface_flush( struct window_surface *window_surface )
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
     unsigned char *src = surface->bits;
     unsigned char *dst = (unsigned char *)surface->image->data;
-    struct bitblt_coords coords;
+    int top, bottom;
+    DWORD now;
+    UINT i;
 
     window_surface->funcs->lock( window_surface );
-    coords.x = 0;
-    coords.y = 0;
-    coords.width  = surface->header.rect.right - surface->header.rect.left;
-    coords.height = surface->header.rect.bottom - surface->header.rect.top;
-    SetRect( &coords.visrect, 0, 0, coords.width, coords.height );
-    if (IntersectRect( &coords.visrect, &coords.visrect, &surface->bounds ))
+    flush_bounds( surface );
+    if (surface->damage_count)
     {
-        TRACE( "flushing %p %dx%d bounds %s bits %p\n",
-               surface, coords.width, coords.height,
-               wine_dbgstr_rect( &surface->bounds ), surface->bits );
+        TRACE( "flushing %p %s bits %p, %u rects\n", surface, wine_dbgstr_rect( &surface->header.rect ),
+               surface->bits, surface->damage_count );
 
         if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
 
@@ -1925,41 +2031,46 @@ static void x11drv_surface_flush( struct window_surface *window_surface )
             int map[256], *mapping = get_window_surface_mapping( surface->image->bits_per_pixel, map );
             int width_bytes = surface->image->bytes_per_line;
 
-            src += coords.visrect.top * width_bytes;
-            dst += coords.visrect.top * width_bytes;
-            copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
-                                 coords.visrect.bottom - coords.visrect.top,
-                                 surface->byteswap, mapping, ~0u, surface->alpha_bits );
-        }
-        else if (surface->alpha_bits)
-        {
-            int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
-            ULONG *ptr = (ULONG *)dst + coords.visrect.top * stride;
-
-            for (y = coords.visrect.top; y < coords.visrect.bottom; y++, ptr += stride)
-                for (x = coords.visrect.left; x < coords.visrect.right; x++)
-                    ptr[x] |= surface->alpha_bits;
+            /* copy_image_byteswap works on full rows, so convert each band of
+             * damaged rows once, even if several rectangles span it */
+            for (top = INT_MIN;;)
+            {
+                bottom = INT_MAX;
+                for (i = 0; i < surface->damage_count; i++)
+                    if (surface->damage[i].bottom > top && surface->damage[i].top < bottom)
+                        bottom = surface->damage[i].top;
+                if (bottom == INT_MAX) break;
+                top = max( top, bottom );
+                for (bottom = top, i = 0; i < surface->damage_count; i++)
+                {
+                    if (surface->damage[i].top > bottom || surface->damage[i].bottom <= bottom) continue;
+                    bottom = surface->damage[i].bottom;
+                    i = ~0u;  /* restart, the band may now reach other rectangles */
+                }
+                copy_image_byteswap( &surface->info, src + top * width_bytes, dst + top * width_bytes,
+                                     width_bytes, width_bytes, bottom - top,
+                                     surface->byteswap, mapping, ~0u, surface->alpha_bits );
+                top = bottom;
+            }
         }
 
-#ifdef HAVE_LIBXXSHM
-        if (surface->shminfo.shmid != -1)
-            XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                          coords.visrect.left, coords.visrect.top,
-                          surface->header.rect.left + coords.visrect.left,
-                          surface->header.rect.top + coords.visrect.top,
-                          coords.visrect.right - coords.visrect.left,
-                          coords.visrect.bottom - coords.visrect.top, False );
-        else
-#endif
-        XPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                   coords.visrect.left, coords.visrect.top,
-                   surface->header.rect.left + coords.visrect.left,
-                   surface->header.rect.top + coords.visrect.top,
-                   coords.visrect.right - coords.visrect.left,
-                   coords.visrect.bottom - coords.visrect.top );
+        for (i = 0; i < surface->damage_count; i++) put_surface_rect( surface, &surface->damage[i] );
+        surface->damage_count = 0;
         XFlush( gdi_display );
+
+        if (TRACE_ON(fps))
+        {
+            now = NtGetTickCount();
+            if (!surface->stats_time) surface->stats_time = now;
+            else if (now - surface->stats_time > 1000)
+            {
+                TRACE_(fps)( "%p: %s bytes/s\n", surface,
+                             wine_dbgstr_longlong( surface->bytes_flushed * 1000 / (now - surface->stats_time) ));
+                surface->bytes_flushed = 0;
+                surface->stats_time = now;
+            }
+        }
     }
-    reset_bounds( &surface->bounds );
     window_surface->funcs->unlock( window_surface );
 }
 
@@ -0,0 +1,362 @@
+/*
+ * Persistent cache of translated shaders
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vkd3d_private.h"
+
+#include <stdio.h>
+#ifndef _WIN32
+# include <unistd.h>
+#endif
+
+/* The cache stores one file per translated shader, in the directory given by
+ * VKD3D_SHADER_CACHE_PATH. Files are named after the hash of their key, which
+ * is made of the vkd3d-shader version, the shader stage, the DXBC checksum and
+ * everything from the compile info chain that affects the generated SPIR-V.
+ * The full key is stored along with the SPIR-V, and compared on load.
+ *
+ * The cache is bounded to VKD3D_SHADER_CACHE_SLOT_COUNT files: the file name
+ * only uses the key hash modulo the slot count, and an entry replaces any
+ * other entry mapping to the same slot. The size of the cache is therefore
+ * bounded by the slot count times the size of the largest shader.
+ *
+ * Entries are written to a temporary file, which is then renamed over the
+ * slot. Readers therefore see either a complete old entry or a complete new
+ * one, and the stored key tells them whether it's the entry they want. Stores
+ * of different keys to the same slot simply replace each other, so no locking
+ * is needed. */
+
+#define VKD3D_SHADER_CACHE_MAGIC VKD3D_MAKE_TAG('V', 'S', 'C', '1')
+#define VKD3D_SHADER_CACHE_SLOT_COUNT 4096
+
+#define VKD3D_DXBC_HEADER_SIZE (8 * sizeof(uint32_t))
+
+struct vkd3d_shader_cache_header
+{
+    uint32_t magic;
+    uint32_t key_size;
+    uint32_t spirv_size;
+    uint32_t checksum;
+};
+
+static uint64_t vkd3d_shader_cache_hash(const void *data, size_t size, uint64_t hash)
+{
+    const uint8_t *ptr = data;
+
+    /* 64-bit FNV-1a. */
+    while (size--)
+        hash = (hash ^ *ptr++) * 0x100000001b3ull;
+    return hash;
+}
+
+void vkd3d_shader_cache_init(struct vkd3d_shader_cache *cache)
+{
+    const char *path;
+    size_t len;
+
+    memset(cache, 0, sizeof(*cache));
+
+    if (!(path = getenv("VKD3D_SHADER_CACHE_PATH")) || !(len = strlen(path)))
+        return;
+
+    if (!(cache->path = vkd3d_malloc(len + 2)))
+        return;
+    memcpy(cache->path, path, len);
+    if (path[len - 1] != '/' && path[len - 1] != '\\')
+        cache->path[len++] = '/';
+    cache->path[len] = 0;
+
+    TRACE("Using shader cache %s.\n", debugstr_a(cache->path));
+}
+
+void vkd3d_shader_cache_cleanup(struct vkd3d_shader_cache *cache)
+{
+    if (!cache->path)
+        return;
+
+    TRACE("Shader cache %s: %u hits, %u misses, %u stores.\n", debugstr_a(cache->path),
+            cache->hits, cache->misses, cache->stores);
+
+    vkd3d_free(cache->path);
+}
+
+static bool vkd3d_shader_cache_key_append(struct vkd3d_shader_cache_key *key, const void *data, size_t size)
+{
+    if (!size)
+        return true;
+    if (!vkd3d_array_reserve((void **)&key->data, &key->capacity, key->size + size, sizeof(*key->data)))
+        return false;
+    memcpy(&key->data[key->size], data, size);
+    key->size += size;
+    return true;
+}
+
+static bool vkd3d_shader_cache_key_append_u32(struct vkd3d_shader_cache_key *key, uint32_t value)
+{
+    return vkd3d_shader_cache_key_append(key, &value, sizeof(value));
+}
+
+static bool vkd3d_shader_cache_key_append_string(struct vkd3d_shader_cache_key *key, const char *str)
+{
+    size_t len = str ? strlen(str) : 0;
+
+    return vkd3d_shader_cache_key_append_u32(key, str ? len : ~0u)
+            && vkd3d_shader_cache_key_append(key, str, len);
+}
+
+static bool vkd3d_shader_cache_key_append_array(struct vkd3d_shader_cache_key *key,
+        const void *elements, unsigned int count, size_t element_size)
+{
+    return vkd3d_shader_cache_key_append_u32(key, elements ? count : ~0u)
+            && (!elements || vkd3d_shader_cache_key_append(key, elements, count * element_size));
+}
+
+static bool vkd3d_shader_cache_key_append_xfb_info(struct vkd3d_shader_cache_key *key,
+        const struct vkd3d_shader_transform_feedback_info *xfb_info)
+{
+    const struct vkd3d_shader_transform_feedback_element *e;
+    unsigned int i;
+
+    if (!vkd3d_shader_cache_key_append_u32(key, xfb_info->element_count))
+        return false;
+    for (i = 0; i < xfb_info->element_count; ++i)
+    {
+        e = &xfb_info->elements[i];
+        if (!vkd3d_shader_cache_key_append_u32(key, e->stream_index)
+                || !vkd3d_shader_cache_key_append_string(key, e->semantic_name)
+                || !vkd3d_shader_cache_key_append_u32(key, e->semantic_index)
+                || !vkd3d_shader_cache_key_append_u32(key,
+                        e->component_index | e->component_count << 8 | e->output_slot << 16))
+            return false;
+    }
+
+    return vkd3d_shader_cache_key_append_array(key, xfb_info->buffer_strides,
+            xfb_info->buffer_stride_count, sizeof(*xfb_info->buffer_strides));
+}
+
+/* Returns false if the shader can't be cached, because the compile info chain
+ * contains structures the key doesn't know about. */
+bool vkd3d_shader_cache_key_init(struct vkd3d_shader_cache_key *key, VkShaderStageFlagBits stage,
+        const struct vkd3d_shader_compile_info *compile_info)
+{
+    const struct vkd3d_shader_interface_info *iface = compile_info->next;
+    const struct vkd3d_shader_descriptor_offset_info *offset_info;
+    const struct vkd3d_shader_spirv_target_info *target_info;
+    const struct vkd3d_shader_code *dxbc = &compile_info->source;
+    const struct
+    {
+        enum vkd3d_shader_structure_type type;
+        const void *next;
+    } *s;
+    bool ret = true;
+
+    memset(key, 0, sizeof(*key));
+
+    if (compile_info->source_type != VKD3D_SHADER_SOURCE_DXBC_TPF
+            || dxbc->size < VKD3D_DXBC_HEADER_SIZE || memcmp(dxbc->code, "DXBC", 4))
+        return false;
+
+    /* The DXBC checksum is part of its header, and covers the rest of the
+     * bytecode. */
+    ret &= vkd3d_shader_cache_key_append_string(key, vkd3d_shader_get_version(NULL, NULL));
+    ret &= vkd3d_shader_cache_key_append_u32(key, stage);
+    ret &= vkd3d_shader_cache_key_append_u32(key, compile_info->target_type);
+    ret &= vkd3d_shader_cache_key_append_array(key, compile_info->options,
+            compile_info->option_count, sizeof(*compile_info->options));
+    ret &= vkd3d_shader_cache_key_append_u32(key, dxbc->size);
+    ret &= vkd3d_shader_cache_key_append(key, (const uint8_t *)dxbc->code + 4, 16);
+
+    for (s = compile_info->next; s && ret; s = s->next)
+    {
+        ret &= vkd3d_shader_cache_key_append_u32(key, s->type);
+
+        switch (s->type)
+        {
+            case VKD3D_SHADER_STRUCTURE_TYPE_INTERFACE_INFO:
+                iface = (const void *)s;
+                ret &= vkd3d_shader_cache_key_append_array(key, iface->bindings,
+                        iface->binding_count, sizeof(*iface->bindings));
+                ret &= vkd3d_shader_cache_key_append_array(key, iface->push_constant_buffers,
+                        iface->push_constant_buffer_count, sizeof(*iface->push_constant_buffers));
+                ret &= vkd3d_shader_cache_key_append_array(key, iface->combined_samplers,
+                        iface->combined_sampler_count, sizeof(*iface->combined_samplers));
+                ret &= vkd3d_shader_cache_key_append_array(key, iface->uav_counters,
+                        iface->uav_counter_count, sizeof(*iface->uav_counters));
+                break;
+
+            case VKD3D_SHADER_STRUCTURE_TYPE_SPIRV_TARGET_INFO:
+                target_info = (const void *)s;
+                ret &= vkd3d_shader_cache_key_append_string(key, target_info->entry_point);
+                ret &= vkd3d_shader_cache_key_append_u32(key, target_info->environment);
+                ret &= vkd3d_shader_cache_key_append_array(key, target_info->extensions,
+                        target_info->extension_count, sizeof(*target_info->extensions));
+                ret &= vkd3d_shader_cache_key_append_array(key, target_info->parameters,
+                        target_info->parameter_count, sizeof(*target_info->parameters));
+                ret &= vkd3d_shader_cache_key_append_u32(key, target_info->dual_source_blending);
+                ret &= vkd3d_shader_cache_key_append_array(key, target_info->output_swizzles,
+                        target_info->output_swizzle_count, sizeof(*target_info->output_swizzles));
+                break;
+
+            case VKD3D_SHADER_STRUCTURE_TYPE_DESCRIPTOR_OFFSET_INFO:
+                /* The offset arrays match the bindings and UAV counters of the
+                 * interface info, which is the head of the chain. */
+                offset_info = (const void *)s;
+                if (!iface || iface->type != VKD3D_SHADER_STRUCTURE_TYPE_INTERFACE_INFO)
+                {
+                    ret = false;
+                    break;
+                }
+                ret &= vkd3d_shader_cache_key_append_u32(key, offset_info->descriptor_table_offset);
+                ret &= vkd3d_shader_cache_key_append_u32(key, offset_info->descriptor_table_count);
+                ret &= vkd3d_shader_cache_key_append_array(key, offset_info->binding_offsets,
+                        iface->binding_count, sizeof(*offset_info->binding_offsets));
+                ret &= vkd3d_shader_cache_key_append_array(key, offset_info->uav_counter_offsets,
+                        iface->uav_counter_count, sizeof(*offset_info->uav_counter_offsets));
+                break;
+
+            case VKD3D_SHADER_STRUCTURE_TYPE_TRANSFORM_FEEDBACK_INFO:
+                ret &= vkd3d_shader_cache_key_append_xfb_info(key, (const void *)s);
+                break;
+
+            default:
+                TRACE("Not caching shader with structure type %#x.\n", s->type);
+                ret = false;
+                break;
+        }
+    }
+
+    if (!ret)
+    {
+        vkd3d_shader_cache_key_cleanup(key);
+        return false;
+    }
+
+    key->hash = vkd3d_shader_cache_hash(key->data, key->size, 0xcbf29ce484222325ull);
+    return true;
+}
+
+void vkd3d_shader_cache_key_cleanup(struct vkd3d_shader_cache_key *key)
+{
+    vkd3d_free(key->data);
+    memset(key, 0, sizeof(*key));
+}
+
+static void vkd3d_shader_cache_get_file_name(const struct vkd3d_shader_cache *cache,
+        uint64_t hash, char *buffer, size_t size)
+{
+    snprintf(buffer, size, "%s%03x.spv", cache->path, (uint32_t)(hash % VKD3D_SHADER_CACHE_SLOT_COUNT));
+}
+
+static unsigned int vkd3d_shader_cache_get_process_id(void)
+{
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return getpid();
+#endif
+}
+
+static bool vkd3d_shader_cache_replace_file(const char *src, const char *dst)
+{
+#ifdef _WIN32
+    return MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING);
+#else
+    return !rename(src, dst);
+#endif
+}
+
+bool vkd3d_shader_cache_load(struct vkd3d_shader_cache *cache,
+        const struct vkd3d_shader_cache_key *key, struct vkd3d_shader_code *spirv)
+{
+    struct vkd3d_shader_cache_header header;
+    uint8_t *key_data = NULL;
+    void *code = NULL;
+    char name[512];
+    FILE *file;
+
+    if (!cache->path)
+        return false;
+
+    vkd3d_shader_cache_get_file_name(cache, key->hash, name, sizeof(name));
+    if (!(file = fopen(name, "rb")))
+    {
+        InterlockedIncrement(&cache->misses);
+        return false;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != VKD3D_SHADER_CACHE_MAGIC
+            || header.key_size != key->size || !header.spirv_size || header.spirv_size % 4
+            || !(key_data = vkd3d_malloc(header.key_size)) || !(code = vkd3d_malloc(header.spirv_size))
+            || fread(key_data, 1, header.key_size, file) != header.key_size
+            || memcmp(key_data, key->data, key->size)
+            || fread(code, 1, header.spirv_size, file) != header.spirv_size
+            || (uint32_t)vkd3d_shader_cache_hash(code, header.spirv_size, key->hash) != header.checksum)
+    {
+        TRACE("Ignoring invalid or replaced shader cache entry %s.\n", debugstr_a(name));
+        vkd3d_free(code);
+        vkd3d_free(key_data);
+        fclose(file);
+        InterlockedIncrement(&cache->misses);
+        return false;
+    }
+
+    vkd3d_free(key_data);
+    fclose(file);
+
+    InterlockedIncrement(&cache->hits);
+    spirv->code = code;
+    spirv->size = header.spirv_size;
+    return true;
+}
+
+void vkd3d_shader_cache_store(struct vkd3d_shader_cache *cache,
+        const struct vkd3d_shader_cache_key *key, const struct vkd3d_shader_code *spirv)
+{
+    struct vkd3d_shader_cache_header header;
+    char name[512], tmp_name[512 + 18];
+    FILE *file;
+    bool ret;
+
+    if (!cache->path || key->size > UINT32_MAX || spirv->size > UINT32_MAX)
+        return;
+
+    header.magic = VKD3D_SHADER_CACHE_MAGIC;
+    header.key_size = key->size;
+    header.spirv_size = spirv->size;
+    header.checksum = vkd3d_shader_cache_hash(spirv->code, spirv->size, key->hash);
+
+    /* The temporary name is unique to this store, even between threads. */
+    vkd3d_shader_cache_get_file_name(cache, key->hash, name, sizeof(name));
+    snprintf(tmp_name, sizeof(tmp_name), "%s.%08x.%08x", name, vkd3d_shader_cache_get_process_id(),
+            (unsigned int)InterlockedIncrement(&cache->temp_id));
+    if (!(file = fopen(tmp_name, "wb")))
+    {
+        WARN("Failed to create shader cache entry %s.\n", debugstr_a(tmp_name));
+        return;
+    }
+    ret = fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(key->data, 1, key->size, file) == key->size
+            && fwrite(spirv->code, 1, spirv->size, file) == spirv->size;
+    if (fclose(file) || !ret || !vkd3d_shader_cache_replace_file(tmp_name, name))
+    {
+        WARN("Failed to write shader cache entry %s.\n", debugstr_a(name));
+        remove(tmp_name);
+        return;
+    }
+
+    InterlockedIncrement(&cache->stores);
+}
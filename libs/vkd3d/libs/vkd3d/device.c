@@ -1909,6 +1909,8 @@ static HRESULT d3d12_device_init_pipeline_cache(struct d3d12_device *device)
         device->vk_pipeline_cache = VK_NULL_HANDLE;
     }
 
+    vkd3d_shader_cache_init(&device->shader_cache);
+
     return S_OK;
 }
 
@@ -1918,6 +1920,7 @@ static void d3d12_device_destroy_pipeline_cache(struct d3d12_device *device)
 
     if (device->vk_pipeline_cache)
         VK_CALL(vkDestroyPipelineCache(device->vk_device, device->vk_pipeline_cache, NULL));
+    vkd3d_shader_cache_cleanup(&device->shader_cache);
 
     vkd3d_mutex_destroy(&device->mutex);
 }
@@ -3119,9 +3122,10 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_CheckFeatureSupport(ID3D12Device *
 
             /* FIXME: The d3d12 documentation states that
              * D3D12_SHADER_CACHE_SUPPORT_SINGLE_PSO is always supported, but
-             * the CachedPSO field of D3D12_GRAPHICS_PIPELINE_STATE_DESC is
-             * ignored and GetCachedBlob() is a stub. */
-            data->SupportFlags = D3D12_SHADER_CACHE_SUPPORT_NONE;
+             * cached blobs only contain shaders when the shader cache is
+             * enabled. */
+            data->SupportFlags = device->shader_cache.path
+                    ? D3D12_SHADER_CACHE_SUPPORT_SINGLE_PSO : D3D12_SHADER_CACHE_SUPPORT_NONE;
 
             TRACE("Shader cache support %#x.\n", data->SupportFlags);
             return S_OK;
@@ -1640,6 +1640,14 @@ static void d3d12_pipeline_uav_counter_state_cleanup(struct d3d12_pipeline_uav_c
     vkd3d_free(uav_counters->bindings);
 }
 
+static void d3d12_pipeline_state_cleanup_shader_keys(struct d3d12_pipeline_state *state)
+{
+    unsigned int i;
+
+    for (i = 0; i < state->shader_count; ++i)
+        vkd3d_shader_cache_key_cleanup(&state->shaders[i].key);
+}
+
 static ULONG STDMETHODCALLTYPE d3d12_pipeline_state_Release(ID3D12PipelineState *iface)
 {
     struct d3d12_pipeline_state *state = impl_from_ID3D12PipelineState(iface);
@@ -1660,6 +1668,7 @@ static ULONG STDMETHODCALLTYPE d3d12_pipeline_state_Release(ID3D12PipelineState
             VK_CALL(vkDestroyPipeline(device->vk_device, state->u.compute.vk_pipeline, NULL));
 
         d3d12_pipeline_uav_counter_state_cleanup(&state->uav_counters, device);
+        d3d12_pipeline_state_cleanup_shader_keys(state);
 
         vkd3d_free(state);
 
@@ -1724,12 +1733,143 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_state_GetDevice(ID3D12PipelineSt
     return d3d12_device_query_interface(state->device, iid, device);
 }
 
+/* Cached pipeline state blobs contain the full shader cache key of each
+ * shader, followed by the SPIR-V of the shaders found in the shader cache. */
+#define VKD3D_CACHED_PIPELINE_STATE_MAGIC VKD3D_MAKE_TAG('V', 'P', 'S', '2')
+
+struct d3d12_cached_pipeline_state_header
+{
+    uint32_t magic;
+    uint32_t shader_count;
+};
+
+struct d3d12_cached_pipeline_state_shader
+{
+    uint32_t stage;
+    uint32_t key_size;
+    uint32_t spirv_size;
+    uint32_t reserved;
+};
+
+/* Returns S_OK if the blob contains SPIR-V for the shader, S_FALSE if there is
+ * no blob or it only contains the key of the shader, and E_INVALIDARG if the
+ * blob is invalid or was not created for this shader. */
+static HRESULT d3d12_cached_pipeline_state_get_spirv(const D3D12_CACHED_PIPELINE_STATE *cached_pso,
+        VkShaderStageFlagBits stage, const struct vkd3d_shader_cache_key *key, struct vkd3d_shader_code *spirv)
+{
+    const uint8_t *data = cached_pso ? cached_pso->pCachedBlob : NULL;
+    struct d3d12_cached_pipeline_state_header header;
+    struct d3d12_cached_pipeline_state_shader shader;
+    size_t size, offset;
+    unsigned int i;
+    void *code;
+
+    if (!data || !(size = cached_pso->CachedBlobSizeInBytes))
+        return S_FALSE;
+
+    if (size < sizeof(header))
+    {
+        WARN("Invalid cached pipeline state blob.\n");
+        return E_INVALIDARG;
+    }
+
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != VKD3D_CACHED_PIPELINE_STATE_MAGIC || header.shader_count > VKD3D_MAX_SHADER_STAGES
+            || size < sizeof(header) + header.shader_count * sizeof(shader))
+    {
+        WARN("Invalid cached pipeline state blob.\n");
+        return E_INVALIDARG;
+    }
+
+    offset = sizeof(header) + header.shader_count * sizeof(shader);
+    for (i = 0; i < header.shader_count; ++i)
+    {
+        memcpy(&shader, &data[sizeof(header) + i * sizeof(shader)], sizeof(shader));
+        if (shader.key_size > size - offset || shader.spirv_size > size - offset - shader.key_size)
+        {
+            WARN("Invalid cached pipeline state blob.\n");
+            return E_INVALIDARG;
+        }
+
+        if (shader.stage == stage && shader.key_size == key->size
+                && !memcmp(&data[offset], key->data, key->size))
+        {
+            if (!shader.spirv_size || !spirv)
+                return S_FALSE;
+            /* The blob is not necessarily suitably aligned for SPIR-V. */
+            if (!(code = vkd3d_malloc(shader.spirv_size)))
+                return E_OUTOFMEMORY;
+            memcpy(code, &data[offset + shader.key_size], shader.spirv_size);
+            spirv->code = code;
+            spirv->size = shader.spirv_size;
+            return S_OK;
+        }
+        offset += shader.key_size + shader.spirv_size;
+    }
+
+    WARN("Cached pipeline state blob doesn't match the pipeline state.\n");
+    return E_INVALIDARG;
+}
+
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_state_GetCachedBlob(ID3D12PipelineState *iface,
         ID3DBlob **blob)
 {
-    FIXME("iface %p, blob %p stub!\n", iface, blob);
+    struct d3d12_pipeline_state *state = impl_from_ID3D12PipelineState(iface);
+    struct vkd3d_shader_code spirv[VKD3D_MAX_SHADER_STAGES] = {0};
+    struct d3d12_cached_pipeline_state_header header;
+    struct d3d12_cached_pipeline_state_shader shader;
+    const struct vkd3d_shader_cache_key *key;
+    size_t size, offset;
+    unsigned int i;
+    uint8_t *data;
+    HRESULT hr;
+
+    TRACE("iface %p, blob %p.\n", iface, blob);
+
+    offset = sizeof(header) + state->shader_count * sizeof(shader);
+    size = offset;
+    for (i = 0; i < state->shader_count; ++i)
+    {
+        key = &state->shaders[i].key;
+        size += key->size;
+        if (vkd3d_shader_cache_load(&state->device->shader_cache, key, &spirv[i]))
+            size += spirv[i].size;
+    }
 
-    return E_NOTIMPL;
+    if (!(data = vkd3d_malloc(size)))
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    header.magic = VKD3D_CACHED_PIPELINE_STATE_MAGIC;
+    header.shader_count = state->shader_count;
+    memcpy(data, &header, sizeof(header));
+    for (i = 0; i < state->shader_count; ++i)
+    {
+        key = &state->shaders[i].key;
+        shader.stage = state->shaders[i].stage;
+        shader.key_size = key->size;
+        shader.spirv_size = spirv[i].size;
+        shader.reserved = 0;
+        memcpy(&data[sizeof(header) + i * sizeof(shader)], &shader, sizeof(shader));
+        memcpy(&data[offset], key->data, key->size);
+        offset += key->size;
+        if (spirv[i].size)
+            memcpy(&data[offset], spirv[i].code, spirv[i].size);
+        offset += spirv[i].size;
+    }
+
+    if (FAILED(hr = vkd3d_blob_create(data, size, blob)))
+    {
+        WARN("Failed to create blob, hr %#x.\n", hr);
+        vkd3d_free(data);
+    }
+
+done:
+    for (i = 0; i < state->shader_count; ++i)
+        vkd3d_shader_free_shader_code(&spirv[i]);
+    return hr;
 }
 
 static const struct ID3D12PipelineStateVtbl d3d12_pipeline_state_vtbl =
@@ -1757,15 +1897,22 @@ struct d3d12_pipeline_state *unsafe_impl_from_ID3D12PipelineState(ID3D12Pipeline
     return impl_from_ID3D12PipelineState(iface);
 }
 
+/* The SPIR-V is looked up in the shader cache, then in the cached pipeline
+ * state blob, and only compiled if found in neither. SPIR-V coming from the
+ * application supplied blob is never stored in the shader cache. */
 static HRESULT create_shader_stage(struct d3d12_device *device,
         struct VkPipelineShaderStageCreateInfo *stage_desc, enum VkShaderStageFlagBits stage,
-        const D3D12_SHADER_BYTECODE *code, const struct vkd3d_shader_interface_info *shader_interface)
+        const D3D12_SHADER_BYTECODE *code, const struct vkd3d_shader_interface_info *shader_interface,
+        const D3D12_CACHED_PIPELINE_STATE *cached_pso, struct d3d12_pipeline_state *state)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     struct vkd3d_shader_compile_info compile_info;
     struct VkShaderModuleCreateInfo shader_desc;
     struct vkd3d_shader_code spirv = {0};
+    struct vkd3d_shader_cache_key key;
+    bool cacheable;
     VkResult vr;
+    HRESULT hr;
     int ret;
 
     static const struct vkd3d_shader_compile_option options[] =
@@ -1795,11 +1942,46 @@ static HRESULT create_shader_stage(struct d3d12_device *device,
     compile_info.log_level = VKD3D_SHADER_LOG_NONE;
     compile_info.source_name = NULL;
 
-    if ((ret = vkd3d_shader_compile(&compile_info, &spirv, NULL)) < 0)
+    cacheable = vkd3d_shader_cache_key_init(&key, stage, &compile_info);
+
+    /* Blobs created for another pipeline state are rejected, even if the
+     * shader cache has the SPIR-V. */
+    if (cacheable && FAILED(hr = d3d12_cached_pipeline_state_get_spirv(cached_pso, stage, &key, NULL)))
     {
-        WARN("Failed to compile shader, vkd3d result %d.\n", ret);
-        return hresult_from_vkd3d_result(ret);
+        vkd3d_shader_cache_key_cleanup(&key);
+        return hr;
+    }
+
+    if (cacheable && vkd3d_shader_cache_load(&device->shader_cache, &key, &spirv))
+    {
+        TRACE("Using cached SPIR-V for shader %#"PRIx64".\n", key.hash);
+    }
+    else if (cacheable && d3d12_cached_pipeline_state_get_spirv(cached_pso, stage, &key, &spirv) == S_OK)
+    {
+        TRACE("Using SPIR-V from cached pipeline state for shader %#"PRIx64".\n", key.hash);
+    }
+    else
+    {
+        if ((ret = vkd3d_shader_compile(&compile_info, &spirv, NULL)) < 0)
+        {
+            WARN("Failed to compile shader, vkd3d result %d.\n", ret);
+            vkd3d_shader_cache_key_cleanup(&key);
+            return hresult_from_vkd3d_result(ret);
+        }
+        if (cacheable)
+            vkd3d_shader_cache_store(&device->shader_cache, &key, &spirv);
+    }
+
+    if (cacheable && state)
+    {
+        state->shaders[state->shader_count].stage = stage;
+        state->shaders[state->shader_count++].key = key;
     }
+    else
+    {
+        vkd3d_shader_cache_key_cleanup(&key);
+    }
+
     shader_desc.codeSize = spirv.size;
     shader_desc.pCode = spirv.code;
 
@@ -1840,7 +2022,8 @@ static int vkd3d_scan_dxbc(const D3D12_SHADER_BYTECODE *code,
 
 static HRESULT vkd3d_create_compute_pipeline(struct d3d12_device *device,
         const D3D12_SHADER_BYTECODE *code, const struct vkd3d_shader_interface_info *shader_interface,
-        VkPipelineLayout vk_pipeline_layout, VkPipeline *vk_pipeline)
+        VkPipelineLayout vk_pipeline_layout, const D3D12_CACHED_PIPELINE_STATE *cached_pso,
+        struct d3d12_pipeline_state *state, VkPipeline *vk_pipeline)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkComputePipelineCreateInfo pipeline_info;
@@ -1851,7 +2034,7 @@ static HRESULT vkd3d_create_compute_pipeline(struct d3d12_device *device,
     pipeline_info.pNext = NULL;
     pipeline_info.flags = 0;
     if (FAILED(hr = create_shader_stage(device, &pipeline_info.stage,
-            VK_SHADER_STAGE_COMPUTE_BIT, code, shader_interface)))
+            VK_SHADER_STAGE_COMPUTE_BIT, code, shader_interface, cached_pso, state)))
         return hr;
     pipeline_info.layout = vk_pipeline_layout;
     pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
@@ -2009,6 +2192,7 @@ static HRESULT d3d12_pipeline_state_init_compute(struct d3d12_pipeline_state *st
     state->refcount = 1;
 
     memset(&state->uav_counters, 0, sizeof(state->uav_counters));
+    state->shader_count = 0;
 
     if (!(root_signature = unsafe_impl_from_ID3D12RootSignature(desc->pRootSignature)))
     {
@@ -2051,7 +2235,7 @@ static HRESULT d3d12_pipeline_state_init_compute(struct d3d12_pipeline_state *st
     vk_pipeline_layout = state->uav_counters.vk_pipeline_layout
             ? state->uav_counters.vk_pipeline_layout : root_signature->vk_pipeline_layout;
     if (FAILED(hr = vkd3d_create_compute_pipeline(device, &desc->CS, &shader_interface,
-            vk_pipeline_layout, &state->u.compute.vk_pipeline)))
+            vk_pipeline_layout, &desc->CachedPSO, state, &state->u.compute.vk_pipeline)))
     {
         WARN("Failed to create Vulkan compute pipeline, hr %#x.\n", hr);
         d3d12_pipeline_uav_counter_state_cleanup(&state->uav_counters, device);
@@ -2082,6 +2266,7 @@ HRESULT d3d12_pipeline_state_create_compute(struct d3d12_device *device,
 
     if (FAILED(hr = d3d12_pipeline_state_init_compute(object, device, desc)))
     {
+        d3d12_pipeline_state_cleanup_shader_keys(object);
         vkd3d_free(object);
         return hr;
     }
@@ -2592,6 +2777,7 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
     state->refcount = 1;
 
     memset(&state->uav_counters, 0, sizeof(state->uav_counters));
+    state->shader_count = 0;
     graphics->stage_count = 0;
 
     memset(&input_signature, 0, sizeof(input_signature));
@@ -2710,7 +2896,7 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
         if (!desc->PS.pShaderBytecode)
         {
             if (FAILED(hr = create_shader_stage(device, &graphics->stages[graphics->stage_count],
-                    VK_SHADER_STAGE_FRAGMENT_BIT, &default_ps, NULL)))
+                    VK_SHADER_STAGE_FRAGMENT_BIT, &default_ps, NULL, &desc->CachedPSO, state)))
                 goto fail;
 
             ++graphics->stage_count;
@@ -2874,7 +3060,7 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
             vkd3d_prepend_struct(&shader_interface, &offset_info);
 
         if (FAILED(hr = create_shader_stage(device, &graphics->stages[graphics->stage_count],
-                shader_stages[i].stage, b, &shader_interface)))
+                shader_stages[i].stage, b, &shader_interface, &desc->CachedPSO, state)))
             goto fail;
 
         ++graphics->stage_count;
@@ -3071,6 +3257,7 @@ HRESULT d3d12_pipeline_state_create_graphics(struct d3d12_device *device,
 
     if (FAILED(hr = d3d12_pipeline_state_init_graphics(object, device, desc)))
     {
+        d3d12_pipeline_state_cleanup_shader_keys(object);
         vkd3d_free(object);
         return hr;
     }
@@ -3557,7 +3744,7 @@ HRESULT vkd3d_uav_clear_state_init(struct vkd3d_uav_clear_state *state, struct d
             binding.flags = VKD3D_SHADER_BINDING_FLAG_IMAGE;
 
         if (FAILED(hr = vkd3d_create_compute_pipeline(device, &pipelines[i].code, &shader_interface,
-                *pipelines[i].pipeline_layout, pipelines[i].pipeline)))
+                *pipelines[i].pipeline_layout, NULL, NULL, pipelines[i].pipeline)))
         {
             ERR("Failed to create compute pipeline %u, hr %#x.\n", i, hr);
             goto fail;
@@ -440,6 +440,34 @@ HRESULT vkd3d_render_pass_cache_find(struct vkd3d_render_pass_cache *cache, stru
         const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass);
 void vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache);
 
+struct vkd3d_shader_cache
+{
+    char *path;
+
+    LONG hits;
+    LONG misses;
+    LONG stores;
+    LONG temp_id;
+};
+
+struct vkd3d_shader_cache_key
+{
+    uint64_t hash;
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+};
+
+void vkd3d_shader_cache_cleanup(struct vkd3d_shader_cache *cache);
+void vkd3d_shader_cache_init(struct vkd3d_shader_cache *cache);
+void vkd3d_shader_cache_key_cleanup(struct vkd3d_shader_cache_key *key);
+bool vkd3d_shader_cache_key_init(struct vkd3d_shader_cache_key *key, VkShaderStageFlagBits stage,
+        const struct vkd3d_shader_compile_info *compile_info);
+bool vkd3d_shader_cache_load(struct vkd3d_shader_cache *cache,
+        const struct vkd3d_shader_cache_key *key, struct vkd3d_shader_code *spirv);
+void vkd3d_shader_cache_store(struct vkd3d_shader_cache *cache,
+        const struct vkd3d_shader_cache_key *key, const struct vkd3d_shader_code *spirv);
+
 struct vkd3d_private_store
 {
     struct vkd3d_mutex mutex;
@@ -996,6 +1024,14 @@ struct d3d12_pipeline_state
 
     struct d3d12_pipeline_uav_counter_state uav_counters;
 
+    /* Shader cache keys, for GetCachedBlob(). */
+    struct
+    {
+        VkShaderStageFlagBits stage;
+        struct vkd3d_shader_cache_key key;
+    } shaders[VKD3D_MAX_SHADER_STAGES];
+    unsigned int shader_count;
+
     struct d3d12_device *device;
 
     struct vkd3d_private_store private_store;
@@ -1335,6 +1371,7 @@ struct d3d12_device
     struct vkd3d_mutex desc_mutex[8];
     struct vkd3d_render_pass_cache render_pass_cache;
     VkPipelineCache vk_pipeline_cache;
+    struct vkd3d_shader_cache shader_cache;
 
     VkPhysicalDeviceMemoryProperties memory_properties;
 
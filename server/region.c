@@ -105,21 +105,122 @@ typedef int (*non_overlap_func_t)( struct region *reg, const rectangle_t *r,
 
 static const rectangle_t empty_rect;  /* all-zero rectangle for empty regions */
 
+/* spare rectangle storage, used when a region operation writes to one of its sources */
+static rectangle_t *scratch_rects;
+static int scratch_size;
+
+/* make sure a region has room for count more rectangles */
+static int reserve_rects( struct region *reg, int count )
+{
+    rectangle_t *new_rects;
+    int new_size;
+
+    if (reg->num_rects + count <= reg->size) return 1;
+
+    new_size = max( reg->size * 2, reg->num_rects + count );
+    new_size = max( new_size, RGN_DEFAULT_RECTS );
+    if (!(new_rects = realloc( reg->rects, new_size * sizeof(*new_rects) )))
+    {
+        set_error( STATUS_NO_MEMORY );
+        return 0;
+    }
+    reg->rects = new_rects;
+    reg->size = new_size;
+    return 1;
+}
+
 /* add a rectangle to a region */
 static inline rectangle_t *add_rect( struct region *reg )
 {
-    if (reg->num_rects >= reg->size)
+    if (reg->num_rects >= reg->size && !reserve_rects( reg, 1 )) return NULL;
+    return reg->rects + reg->num_rects++;
+}
+
+/* add a rectangle to a region that has been reserved room for it */
+static inline void append_rect( struct region *reg, int left, int top, int right, int bottom )
+{
+    rectangle_t *rect = reg->rects + reg->num_rects++;
+
+    rect->left = left;
+    rect->top = top;
+    rect->right = right;
+    rect->bottom = bottom;
+}
+
+/* find the end of the band starting at rect */
+static inline const rectangle_t *get_band_end( const rectangle_t *rect, const rectangle_t *end )
+{
+    const rectangle_t *ptr = rect + 1;
+
+    while (ptr != end && ptr->top == rect->top) ptr++;
+    return ptr;
+}
+
+/* find the first rectangle whose bottom is below y; it always starts a band */
+static const rectangle_t *find_first_band( const rectangle_t *rects, const rectangle_t *end, int y )
+{
+    size_t min = 0, max = end - rects;
+
+    while (min < max)
     {
-        rectangle_t *new_rect = realloc( reg->rects, 2 * sizeof(rectangle_t) * reg->size );
-        if (!new_rect)
+        size_t pos = (min + max) / 2;
+        if (rects[pos].bottom <= y) min = pos + 1;
+        else max = pos;
+    }
+    return rects + min;
+}
+
+/* prepare the destination storage of a region operation; if the destination is also
+ * a source, its rectangles are kept alive in old_rects until end_region_op() */
+static int begin_region_op( struct region *dst, const struct region *src1, const struct region *src2,
+                            int size, rectangle_t **old_rects, int *old_size )
+{
+    *old_rects = NULL;
+    *old_size = 0;
+    if (dst == src1 || dst == src2)
+    {
+        *old_rects = dst->rects;
+        *old_size = dst->size;
+        dst->rects = scratch_rects;
+        dst->size = scratch_size;
+        scratch_rects = NULL;
+        scratch_size = 0;
+    }
+    dst->num_rects = 0;
+    if (reserve_rects( dst, size )) return 1;
+    if (*old_rects)
+    {
+        scratch_rects = dst->rects;
+        scratch_size = dst->size;
+        dst->rects = *old_rects;
+        dst->size = *old_size;
+        *old_rects = NULL;
+    }
+    return 0;
+}
+
+/* release the storage replaced by a region operation, keeping it for the next one */
+static void end_region_op( struct region *dst, rectangle_t *old_rects, int old_size )
+{
+    if (old_rects)
+    {
+        free( scratch_rects );
+        scratch_rects = old_rects;
+        scratch_size = old_size;
+    }
+
+    /* don't keep large arrays around for regions that have become small */
+    if (dst->size > 64 && dst->num_rects < dst->size / 4)
+    {
+        int new_size = max( dst->num_rects * 2, RGN_DEFAULT_RECTS );
+        rectangle_t *new_rects = realloc( dst->rects, new_size * sizeof(*new_rects) );
+
+        if (new_rects)
         {
-            set_error( STATUS_NO_MEMORY );
-            return NULL;
+            dst->rects = new_rects;
+            dst->size = new_size;
         }
-        reg->rects = new_rect;
-        reg->size *= 2;
     }
-    return reg->rects + reg->num_rects++;
 }
 
 /* make sure all the rectangles are valid and that the region is properly y-x-banded */
@@ -219,15 +320,12 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
     const rectangle_t *r1End = r1 + reg1->num_rects;
     const rectangle_t *r2End = r2 + reg2->num_rects;
 
-    rectangle_t *new_rects, *old_rects = newReg->rects;
-    int new_size, ret = 0;
-
-    new_size = max( reg1->num_rects, reg2->num_rects ) * 2;
-    if (!(new_rects = mem_alloc( new_size * sizeof(*newReg->rects) ))) return 0;
+    rectangle_t *old_rects;
+    int old_size, ret = 0;
 
-    newReg->size = new_size;
-    newReg->rects = new_rects;
-    newReg->num_rects = 0;
+    if (!begin_region_op( newReg, reg1, reg2, max( reg1->num_rects, reg2->num_rects ) * 2,
+                          &old_rects, &old_size ))
+        return 0;
 
     if (reg1->extents.top < reg2->extents.top)
         ybot = reg1->extents.top;
@@ -320,20 +418,122 @@ static int region_op( struct region *newReg, const struct region *reg1, const st
     }
 
     if (newReg->num_rects != curBand) coalesce_region(newReg, prevBand, curBand);
+    ret = 1;
+done:
+    end_region_op( newReg, old_rects, old_size );
+    return ret;
+}
+
+/* intersect a region with a single rectangle; equivalent to region_op with intersect_overlapping */
+static int intersect_rect_op( struct region *newReg, const struct region *reg, const rectangle_t *clip )
+{
+    const rectangle_t *r = reg->rects, *ptr, *band_end, *end = reg->rects + reg->num_rects;
+    int top, bottom, left, right, prevBand = 0, curBand;
+    rectangle_t *old_rects;
+    int old_size;
 
-    if ((newReg->num_rects < (newReg->size / 2)) && (newReg->size > 2))
+    if (!begin_region_op( newReg, reg, NULL, reg->num_rects, &old_rects, &old_size )) return 0;
+
+    for (r = find_first_band( r, end, clip->top ); r != end && r->top < clip->bottom; r = band_end)
     {
-        new_size = max( newReg->num_rects, RGN_DEFAULT_RECTS );
-        if ((new_rects = realloc( newReg->rects, sizeof(*newReg->rects) * new_size )))
+        band_end = get_band_end( r, end );
+        top = max( r->top, clip->top );
+        bottom = min( r->bottom, clip->bottom );
+
+        curBand = newReg->num_rects;
+        for (ptr = r; ptr != band_end; ptr++)
         {
-            newReg->rects = new_rects;
-            newReg->size = new_size;
+            left = max( ptr->left, clip->left );
+            right = min( ptr->right, clip->right );
+            if (left < right) append_rect( newReg, left, top, right, bottom );
         }
+        if (newReg->num_rects != curBand) prevBand = coalesce_region( newReg, prevBand, curBand );
     }
-    ret = 1;
-done:
-    free( old_rects );
-    return ret;
+
+    end_region_op( newReg, old_rects, old_size );
+    return 1;
+}
+
+/* copy a band of rectangles with new vertical extents */
+static inline void append_band( struct region *reg, const rectangle_t *r, const rectangle_t *end,
+                                int top, int bottom )
+{
+    for (; r != end; r++) append_rect( reg, r->left, top, r->right, bottom );
+}
+
+/* subtract a single rectangle from a region; equivalent to region_op with subtract_overlapping */
+static int subtract_rect_op( struct region *newReg, const struct region *reg, const rectangle_t *sub )
+{
+    const rectangle_t *r = reg->rects, *ptr, *band_end, *end = reg->rects + reg->num_rects;
+    int top, bottom, prevBand = 0, curBand;
+    rectangle_t *old_rects;
+    int old_size;
+
+    if (!begin_region_op( newReg, reg, NULL, reg->num_rects + 1, &old_rects, &old_size )) return 0;
+
+    /* bands above the rectangle, and bands that overlap it, are coalesced one at a time */
+    for (; r != end; r = band_end)
+    {
+        band_end = get_band_end( r, end );
+
+        /* a band is split in at most three, and at most one of its rectangles in two */
+        if (!reserve_rects( newReg, 3 * (band_end - r) + 1 )) goto error;
+
+        if (r->bottom <= sub->top)
+        {
+            curBand = newReg->num_rects;
+            append_band( newReg, r, band_end, r->top, r->bottom );
+            prevBand = coalesce_region( newReg, prevBand, curBand );
+            continue;
+        }
+        if (r->top >= sub->bottom) break;
+
+        if (r->top < sub->top)
+        {
+            curBand = newReg->num_rects;
+            append_band( newReg, r, band_end, r->top, sub->top );
+            prevBand = coalesce_region( newReg, prevBand, curBand );
+        }
+
+        top = max( r->top, sub->top );
+        bottom = min( r->bottom, sub->bottom );
+        curBand = newReg->num_rects;
+        for (ptr = r; ptr != band_end; ptr++)
+        {
+            if (ptr->right <= sub->left || ptr->left >= sub->right)
+            {
+                append_rect( newReg, ptr->left, top, ptr->right, bottom );
+                continue;
+            }
+            if (ptr->left < sub->left) append_rect( newReg, ptr->left, top, sub->left, bottom );
+            if (ptr->right > sub->right) append_rect( newReg, sub->right, top, ptr->right, bottom );
+        }
+        if (newReg->num_rects != curBand) prevBand = coalesce_region( newReg, prevBand, curBand );
+
+        if (r->bottom > sub->bottom) break;
+        if (r->bottom == sub->bottom)
+        {
+            r = band_end;
+            break;
+        }
+    }
+
+    /* the remaining bands are below the rectangle, and coalesced together */
+    curBand = newReg->num_rects;
+    if (!reserve_rects( newReg, end - r )) goto error;
+    for (; r != end; r = band_end)
+    {
+        band_end = get_band_end( r, end );
+        append_band( newReg, r, band_end, max( r->top, sub->bottom ), r->bottom );
+    }
+    if (newReg->num_rects != curBand) coalesce_region( newReg, prevBand, curBand );
+
+    end_region_op( newReg, old_rects, old_size );
+    return 1;
+
+error:
+    end_region_op( newReg, old_rects, old_size );
+    return 0;
 }
 
 /* recalculate the extents of a region */
@@ -771,7 +971,15 @@ struct region *intersect_region( struct region *dst, const struct region *src1,
         dst->extents.bottom = 0;
         return dst;
     }
-    if (!region_op( dst, src1, src2, intersect_overlapping, NULL, NULL )) return NULL;
+    if (src2->num_rects == 1)
+    {
+        if (!intersect_rect_op( dst, src1, &src2->extents )) return NULL;
+    }
+    else if (src1->num_rects == 1)
+    {
+        if (!intersect_rect_op( dst, src2, &src1->extents )) return NULL;
+    }
+    else if (!region_op( dst, src1, src2, intersect_overlapping, NULL, NULL )) return NULL;
     set_region_extents( dst );
     return dst;
 }
@@ -783,8 +991,12 @@ struct region *subtract_region( struct region *dst, const struct region *src1,
     if (!src1->num_rects || !src2->num_rects || !EXTENTCHECK(&src1->extents, &src2->extents))
         return copy_region( dst, src1 );
 
-    if (!region_op( dst, src1, src2, subtract_overlapping,
-                    subtract_non_overlapping, NULL )) return NULL;
+    if (src2->num_rects == 1)
+    {
+        if (!subtract_rect_op( dst, src1, &src2->extents )) return NULL;
+    }
+    else if (!region_op( dst, src1, src2, subtract_overlapping,
+                         subtract_non_overlapping, NULL )) return NULL;
     set_region_extents( dst );
     return dst;
 }
@@ -65,6 +65,7 @@ static inline char to_hex( char ch )
 
 static inline WCHAR to_lower( WCHAR ch )
 {
+    if (ch < 0x80) return (ch >= 'A' && ch <= 'Z') ? ch + 'a' - 'A' : ch;  /* no table lookups for ASCII */
     return ch + casemap[casemap[casemap[ch >> 8] + ((ch >> 4) & 0x0f)] + (ch & 0x0f)];
 }
 
@@ -73,7 +74,7 @@ int memicmp_strW( const WCHAR *str1, const WCHAR *str2, data_size_t len )
     int ret = 0;
 
     for (len /= sizeof(WCHAR); len; str1++, str2++, len--)
-        if ((ret = to_lower(*str1) - to_lower(*str2))) break;
+        if (*str1 != *str2 && (ret = to_lower(*str1) - to_lower(*str2))) break;
     return ret;
 }
 
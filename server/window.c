@@ -52,6 +52,15 @@ enum property_type
 };
 
 
+/* cached result of get_visible_region for a given set of flags */
+struct vis_cache_entry
+{
+    unsigned int     flags;           /* flags the region was computed for */
+    struct region   *region;          /* visible region, or NULL if unused */
+};
+
+#define VIS_CACHE_SIZE 2
+
 struct window
 {
     struct object    obj;             /* object header */
@@ -94,6 +103,9 @@ struct window
     struct property *properties;      /* window properties array */
     int              nb_extra_bytes;  /* number of extra bytes */
     char            *extra_bytes;     /* extra bytes storage */
+    struct vis_cache_entry vis_cache[VIS_CACHE_SIZE]; /* cached visible regions, most recent first */
+    unsigned int     vis_cache_hits;  /* number of visible region cache hits */
+    unsigned int     vis_cache_misses; /* number of visible region cache misses */
 };
 
 static void window_dump( struct object *obj, int verbose );
@@ -160,7 +172,21 @@ static void window_dump( struct object *obj, int verbose )
 {
     struct window *win = (struct window *)obj;
     assert( obj->ops == &window_ops );
-    fprintf( stderr, "window %p handle %x\n", win, win->handle );
+    fprintf( stderr, "window %p handle %x vis cache hits %u misses %u\n", win, win->handle,
+             win->vis_cache_hits, win->vis_cache_misses );
+}
+
+/* free the cached visible regions of a window */
+static void free_vis_cache( struct window *win )
+{
+    unsigned int i;
+
+    for (i = 0; i < VIS_CACHE_SIZE; i++)
+    {
+        if (!win->vis_cache[i].region) continue;
+        free_region( win->vis_cache[i].region );
+        win->vis_cache[i].region = NULL;
+    }
 }
 
 static void window_destroy( struct object *obj )
@@ -177,6 +203,7 @@ static void window_destroy( struct object *obj )
 
     if (win->win_region) free_region( win->win_region );
     if (win->update_region) free_region( win->update_region );
+    free_vis_cache( win );
     if (win->class) release_class( win->class );
     free( win->text );
 
@@ -253,6 +280,38 @@ static unsigned int get_monitor_dpi( struct window *win )
     return win->dpi ? win->dpi : USER_DEFAULT_SCREEN_DPI;
 }
 
+/* free the cached visible regions of a window and all its descendants */
+static void invalidate_vis_cache_tree( struct window *win )
+{
+    struct window *child;
+
+    free_vis_cache( win );
+    LIST_FOR_EACH_ENTRY( child, &win->children, struct window, entry )
+        invalidate_vis_cache_tree( child );
+    LIST_FOR_EACH_ENTRY( child, &win->unlinked, struct window, entry )
+        invalidate_vis_cache_tree( child );
+}
+
+/* free the cached visible regions that depend on the position, shape or style of a window */
+/* zorder is set if the window was moved in the z-order, or added to or removed from it */
+static void invalidate_vis_cache( struct window *win, int zorder )
+{
+    struct window *ptr;
+    int below = 0;
+
+    invalidate_vis_cache_tree( win );
+
+    /* top-level windows don't clip each other, and the desktop doesn't clip its children */
+    if (!win->parent || is_desktop_window( win->parent )) return;
+
+    free_vis_cache( win->parent );  /* for DCX_CLIPCHILDREN */
+    LIST_FOR_EACH_ENTRY( ptr, &win->parent->children, struct window, entry )
+    {
+        if (ptr == win) below = 1;
+        else if ((below || zorder) && (ptr->style & WS_CLIPSIBLINGS)) invalidate_vis_cache_tree( ptr );
+    }
+}
+
 /* link a window at the right place in the siblings list */
 static void link_window( struct window *win, struct window *previous )
 {
@@ -306,6 +365,7 @@ static void link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    invalidate_vis_cache( win, 1 );
 }
 
 /* change the parent of a window (or unlink the window if the new parent is NULL) */
@@ -323,6 +383,8 @@ static int set_parent_window( struct window *win, struct window *parent )
         }
     }
 
+    if (win->parent) invalidate_vis_cache( win, 1 );
+
     if (parent)
     {
         if (win->parent) release_object( win->parent );
@@ -580,6 +642,9 @@ static struct window *create_window( struct window *parent, struct window *owner
     win->properties     = NULL;
     win->nb_extra_bytes = 0;
     win->extra_bytes    = NULL;
+    win->vis_cache_hits = 0;
+    win->vis_cache_misses = 0;
+    memset( win->vis_cache, 0, sizeof(win->vis_cache) );
     win->window_rect = win->visible_rect = win->surface_rect = win->client_rect = empty_rect;
     list_init( &win->children );
     list_init( &win->unlinked );
@@ -1096,7 +1161,7 @@ static inline struct window *get_top_clipping_window( struct window *win )
 
 
 /* compute the visible region of a window, in window coordinates */
-static struct region *get_visible_region( struct window *win, unsigned int flags )
+static struct region *compute_visible_region( struct window *win, unsigned int flags )
 {
     struct region *tmp = NULL, *region;
     int offset_x, offset_y;
@@ -1175,6 +1240,49 @@ error:
 }
 
 
+/* get the visible region of a window, in window coordinates; the caller owns the returned region */
+static struct region *get_visible_region( struct window *win, unsigned int flags )
+{
+    struct vis_cache_entry *cache = win->vis_cache;
+    struct region *region, *copy;
+    unsigned int i;
+
+    flags &= DCX_WINDOW | DCX_CLIPCHILDREN | DCX_PARENTCLIP;
+
+    for (i = 0; i < VIS_CACHE_SIZE; i++)
+    {
+        struct vis_cache_entry entry = cache[i];
+
+        if (!entry.region || entry.flags != flags) continue;
+        win->vis_cache_hits++;
+        /* move it to the front */
+        memmove( cache + 1, cache, i * sizeof(*cache) );
+        cache[0] = entry;
+        if (!(region = create_empty_region())) return NULL;
+        if (copy_region( region, entry.region )) return region;
+        free_region( region );
+        return NULL;
+    }
+
+    win->vis_cache_misses++;
+    if (!(region = compute_visible_region( win, flags ))) return NULL;
+
+    if ((copy = create_empty_region()) && copy_region( copy, region ))
+    {
+        if (cache[VIS_CACHE_SIZE - 1].region) free_region( cache[VIS_CACHE_SIZE - 1].region );
+        memmove( cache + 1, cache, (VIS_CACHE_SIZE - 1) * sizeof(*cache) );
+        cache[0].flags = flags;
+        cache[0].region = copy;
+    }
+    else
+    {
+        if (copy) free_region( copy );
+        clear_error();  /* the region is still valid, it just won't be cached */
+    }
+    return region;
+}
+
+
 /* clip all children with a custom pixel format out of the visible region */
 static struct region *clip_pixel_format_children( struct window *parent, struct region *parent_clip,
                                                   struct region *region, int offset_x, int offset_y )
@@ -1797,6 +1905,8 @@ static void set_window_pos( struct window *win, struct window *previous,
         }
     }
 
+    invalidate_vis_cache( win, 0 );
+
     /* reset cursor clip rectangle when the desktop changes size */
     if (win == win->desktop->top_window) win->desktop->cursor.clip = *window_rect;
 
@@ -1935,6 +2045,7 @@ static void set_window_region( struct window *win, struct region *region, int re
 
     if (win->win_region) free_region( win->win_region );
     win->win_region = region;
+    invalidate_vis_cache( win, 0 );
 
     /* expose anything revealed by the change */
     if (old_vis_rgn && ((exposed_rgn = expose_window( win, &win->window_rect, old_vis_rgn ))))
@@ -1960,6 +2071,7 @@ void free_window_handle( struct window *win )
     {
         struct region *vis_rgn = get_visible_region( win, DCX_WINDOW );
         win->style &= ~WS_VISIBLE;
+        invalidate_vis_cache( win, 0 );
         if (vis_rgn)
         {
             struct region *exposed_rgn = expose_window( win, &win->window_rect, vis_rgn );
@@ -2252,6 +2364,9 @@ DECL_HANDLER(set_window_info)
     if (req->flags & SET_WIN_EXTRA) memcpy( win->extra_bytes + req->extra_offset,
                                             &req->extra_value, req->extra_size );
 
+    if (win->style != reply->old_style || ((win->ex_style ^ reply->old_ex_style) & WS_EX_TRANSPARENT))
+        invalidate_vis_cache( win, 0 );
+
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;
 }
@@ -2776,6 +2891,7 @@ DECL_HANDLER(update_window_zorder)
         {
             list_remove( &win->entry );
             list_add_before( &ptr->entry, &win->entry );
+            invalidate_vis_cache( win, 1 );
         }
         break;
     }